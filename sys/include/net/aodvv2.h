@@ -42,6 +42,96 @@ extern "C" {
  */
 #define AODVV2_MSG_TYPE_SEND_RREP (0x9001)
 
+/**
+ * @brief   IPC message to process the Local Route Set timeouts
+ */
+#define AODVV2_MSG_TYPE_LRS_TIMEOUT (0x9002)
+
+/**
+ * @brief   IPC message to handle a broken link to a neighbor
+ */
+#define AODVV2_MSG_TYPE_LINK_BROKEN (0x9003)
+
+/**
+ * @brief   IPC message to drop the buffered packets whose discovery failed
+ */
+#define AODVV2_MSG_TYPE_BUFFER_TIMEOUT (0x9004)
+
+/**
+ * @brief   IPC message to retry or give up the route discoveries that got
+ *          no answer
+ */
+#define AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT (0x9005)
+
+/**
+ * @brief   IPC message to send the RFC5444 messages waiting for aggregation
+ */
+#define AODVV2_MSG_TYPE_WRITER_FLUSH (0x9006)
+
+/**
+ * @brief   IPC message to send the multicast RFC5444 packets held back by the
+ *          rate limit
+ */
+#define AODVV2_MSG_TYPE_MCAST_SEND (0x9007)
+
+/**
+ * @brief   IPC message to handle the packets that found no route on the NIB
+ */
+#define AODVV2_MSG_TYPE_ROUTE_USED (0x9008)
+
+/**
+ * @brief   Maximum number of packets waiting for a route
+ *
+ * At most 254, the buffer indexes them with a single byte.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_MAX_BUFFERED_PACKETS
+#define CONFIG_AODVV2_MAX_BUFFERED_PACKETS (10)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of bytes of the packets waiting for a route
+ * @{
+ */
+#ifndef CONFIG_AODVV2_BUFFER_MAX_BYTES
+#define CONFIG_AODVV2_BUFFER_MAX_BYTES (2048)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of destinations with packets waiting for a route
+ *
+ * At most 254, the buffer indexes them with a single byte.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_BUFFER_MAX_DESTS
+#define CONFIG_AODVV2_BUFFER_MAX_DESTS (4)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of packets waiting for a route to a single
+ *          destination
+ * @{
+ */
+#ifndef CONFIG_AODVV2_BUFFER_MAX_PER_DEST
+#define CONFIG_AODVV2_BUFFER_MAX_PER_DEST (4)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of messages queued for the AODVv2 thread, at most 32
+ *
+ * Every RREQ and RREP sent or forwarded, and every broken link notification
+ * takes one until the AODVv2 thread handles it.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_MSG_POOL_SIZE
+#define CONFIG_AODVV2_MSG_POOL_SIZE (8)
+#endif
+/** @} */
+
 typedef struct {
     aodvv2_message_t pkt; /**< Packet to send */
     ipv6_addr_t next_hop; /**< Next hop */
@@ -65,7 +155,10 @@ int aodvv2_init(gnrc_netif_t *netif);
  * @param[in] pkt      The RREQ packet.
  * @param[in] next_hop Where to send the packet.
  *
- * @return Negative number on failure, otherwise succeed.
+ * @return 0 on success.
+ * @return -ENOBUFS if @ref CONFIG_AODVV2_MSG_POOL_SIZE messages are already
+ *         queued.
+ * @return Other negative number on failure.
  */
 int aodvv2_send_rreq(aodvv2_message_t *pkt, ipv6_addr_t *next_hop);
 
@@ -77,7 +170,10 @@ int aodvv2_send_rreq(aodvv2_message_t *pkt, ipv6_addr_t *next_hop);
  * @param[in] pkt      The RREQ packet.
  * @param[in] next_hop Where to send the packet.
  *
- * @return Negative number on failure, otherwise succeed.
+ * @return 0 on success.
+ * @return -ENOBUFS if @ref CONFIG_AODVV2_MSG_POOL_SIZE messages are already
+ *         queued.
+ * @return Other negative number on failure.
  */
 int aodvv2_send_rrep(aodvv2_message_t *pkt, ipv6_addr_t *next_hop);
 
@@ -86,36 +182,66 @@ int aodvv2_send_rrep(aodvv2_message_t *pkt, ipv6_addr_t *next_hop);
  *
  * @pre @p target_addr != NULL && @p orig_addr != NULL
  *
+ * @param[in] orig_addr   The client requesting the route.
  * @param[in] target_addr The IP address where we want a route to.
+ * @param[in] hop_limit   Maximum number of hops the RREQ travels, 0 to search
+ *                        the whole network.
  *
  * @return Negative number on failure, otherwise succeed.
  */
 int aodvv2_find_route(const ipv6_addr_t *orig_addr,
-                      const ipv6_addr_t *target_addr);
+                      const ipv6_addr_t *target_addr, uint8_t hop_limit);
 
 /**
  * @brief   Initialize the AODVv2 packer buffering code.
+ *
+ * @param[in] pid Thread that receives @ref AODVV2_MSG_TYPE_BUFFER_TIMEOUT
+ *                messages, usually the AODVv2 thread.
  */
-void aodvv2_buffer_init(void);
+void aodvv2_buffer_init(kernel_pid_t pid);
 
 /**
  * @brief   Add a packet to the packet buffer
  *
+ * Packets are queued per destination. When a limit is reached the oldest
+ * packets are dropped to make room. Packets still waiting after
+ * @ref AODVV2_DISCOVERY_TIME are dropped as well.
+ *
  * @pre @p dst != NULL && @p pkt != NULL
  *
- * @brief[in] dst Packet destination address.
- * @brief[in] pkt Packet.
+ * @param[in] dst Packet destination address.
+ * @param[in] pkt Packet.
+ *
+ * @return 0 on success.
+ * @return -ENOSPC if the packet alone exceeds the byte budget.
  */
 int aodvv2_buffer_pkt_add(const ipv6_addr_t *dst, gnrc_pktsnip_t *pkt);
 
 /**
- * @brief   Dispatch buffered packets to `targ_addr`
+ * @brief   Drop the buffered packets to dst
+ *
+ * @pre @p dst != NULL
+ *
+ * @param[in] dst Packet destination address.
+ */
+void aodvv2_buffer_drop(const ipv6_addr_t *dst);
+
+/**
+ * @brief   Drop the buffered packets whose route discovery failed.
+ *
+ * Must be called when @ref AODVV2_MSG_TYPE_BUFFER_TIMEOUT is received.
+ */
+void aodvv2_buffer_timeout(void);
+
+/**
+ * @brief   Dispatch buffered packets to `targ_addr`/`pfx_len`
  *
  * @notes Only call this when a route to `targ_addr` is on the NIB
  *
- * @param[in] targ_addr Target address to dispatch packets.
+ * @param[in] targ_addr Target prefix to dispatch packets.
+ * @param[in] pfx_len   Length of the target prefix.
  */
-void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr);
+void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr, uint8_t pfx_len);
 
 #ifdef __cplusplus
 } /* extern "C" */
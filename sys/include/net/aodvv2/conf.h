@@ -30,6 +30,15 @@
 #define CONFIG_AODVV2_MAX_IDLETIME (200)
 #endif
 
+/**
+ * @brief   Time a route stays valid after it was learned, in seconds
+ *
+ * Active routes stay valid past it as long as they're used. The NIB entries
+ * have no lifetime, they're removed when the route stops being valid.
+ */
+#define AODVV2_ROUTE_LIFETIME \
+    (CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME)
+
 #ifndef CONFIG_AODVV2_MAX_BLACKLIST_TIME
 #define CONFIG_AODVV2_MAX_BLACKLIST_TIME (200)
 #endif
@@ -61,5 +70,57 @@
 #define CONFIG_AODVV2_RREQ_HOLDDOWN_TIME (10)
 #endif
 
+/**
+ * @brief   Maximum number of RREQs sent for a single route discovery
+ *
+ * With CONFIG_AODVV2_EXPANDING_RING the last RREQ always searches the whole
+ * network, so only the attempts before it use the ring. It needs at least 2
+ * attempts to have any effect.
+ */
+#ifndef CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX
+#define CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX (3)
+#endif
+
+/**
+ * @brief   Maximum number of route discoveries in flight
+ */
+#ifndef CONFIG_AODVV2_DISCOVERY_MAX_PENDING
+#define CONFIG_AODVV2_DISCOVERY_MAX_PENDING (4)
+#endif
+
+/**
+ * @brief   Hop limit of the first RREQ of a route discovery when
+ *          CONFIG_AODVV2_EXPANDING_RING is enabled
+ */
+#ifndef CONFIG_AODVV2_RING_HOP_LIMIT_START
+#define CONFIG_AODVV2_RING_HOP_LIMIT_START (2)
+#endif
+
+/**
+ * @brief   Hop limit increase on every RREQ sent again
+ */
+#ifndef CONFIG_AODVV2_RING_HOP_LIMIT_STEP
+#define CONFIG_AODVV2_RING_HOP_LIMIT_STEP (2)
+#endif
+
+/**
+ * @brief   Largest hop limit of the expanding ring, RREQs that would go
+ *          beyond it search the whole network
+ */
+#ifndef CONFIG_AODVV2_RING_HOP_LIMIT_THRESHOLD
+#define CONFIG_AODVV2_RING_HOP_LIMIT_THRESHOLD (7)
+#endif
+
+/**
+ * @brief   Time a route discovery waits for a RREP over all its attempts, in
+ *          seconds
+ *
+ * The wait after every RREQ doubles, starting at
+ * @ref CONFIG_AODVV2_RREQ_WAIT_TIME.
+ */
+#define AODVV2_DISCOVERY_TIME \
+    (CONFIG_AODVV2_RREQ_WAIT_TIME * \
+     ((1UL << CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX) - 1))
+
 #endif /* AODVV2_CONF_H */
 /** @} */
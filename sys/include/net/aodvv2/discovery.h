@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @brief       AODVv2 pending route discoveries
+ *
+ * @author      Jean Pierre Dudey <jeandudey@hotmail.com>
+ */
+
+#ifndef AODVV2_DISCOVERY_H
+#define AODVV2_DISCOVERY_H
+
+#include "net/ipv6/addr.h"
+#include "sched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Initialize the pending route discoveries
+ *
+ * @param[in] pid Thread that receives @ref AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT
+ *                messages, usually the AODVv2 thread.
+ */
+void aodvv2_discovery_init(kernel_pid_t pid);
+
+/**
+ * @brief   Find a route to target_addr, unless a route discovery for it is
+ *          already in flight.
+ *
+ * When CONFIG_AODVV2_EXPANDING_RING is enabled the first RREQ only reaches
+ * @ref CONFIG_AODVV2_RING_HOP_LIMIT_START hops, and every following one
+ * @ref CONFIG_AODVV2_RING_HOP_LIMIT_STEP hops more. The last attempt always
+ * searches the whole network.
+ *
+ * A RREQ that gets no RREP is sent again, doubling the wait time after every
+ * attempt, up to @ref CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX RREQs. After that
+ * the packets buffered for @p target_addr are dropped and no new discovery
+ * for it is started for RREQ_HOLDDOWN_TIME.
+ *
+ * @pre @p orig_addr != NULL && @p target_addr != NULL
+ *
+ * @param[in] orig_addr   Address of the client requesting the route.
+ * @param[in] target_addr The IP address where we want a route to.
+ *
+ * @return 1 if a new route discovery was started.
+ * @return 0 if a route discovery for @p target_addr is in flight.
+ * @return -EHOSTUNREACH if @p target_addr is held down.
+ * @return -ENOSPC if @ref CONFIG_AODVV2_DISCOVERY_MAX_PENDING discoveries are
+ *         in flight or held down.
+ * @return Other negative number if the RREQ couldn't be sent.
+ */
+int aodvv2_discovery_start(const ipv6_addr_t *orig_addr,
+                           const ipv6_addr_t *target_addr);
+
+/**
+ * @brief   Hop limit of the RREQ sent on the given attempt of a route
+ *          discovery.
+ *
+ * The expanding ring only covers the attempts before the last one, so with
+ * @ref CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX set to 1 it has no effect.
+ *
+ * @param[in] attempts Number of the attempt, starting at 1.
+ *
+ * @return Hop limit of the RREQ, 0 to search the whole network.
+ */
+uint8_t aodvv2_discovery_hop_limit(uint8_t attempts);
+
+/**
+ * @brief   Finish the route discoveries covered by a received route.
+ *
+ * @pre @p targ_addr != NULL
+ *
+ * @param[in] targ_addr Prefix of the route.
+ * @param[in] pfx_len   Length of the prefix.
+ */
+void aodvv2_discovery_done(const ipv6_addr_t *targ_addr, uint8_t pfx_len);
+
+/**
+ * @brief   Retry or give up the route discoveries that got no answer in time.
+ *
+ * Must be called when @ref AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT is received.
+ */
+void aodvv2_discovery_timeout(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AODVV2_DISCOVERY_H */
+/** @} */
@@ -28,13 +28,15 @@
 #include "net/metric.h"
 
 #include "timex.h"
+#include "xtimer.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief   Maximum number of routing entries
+ * @brief   Number of routing entries when no pool is given to
+ *          @ref aodvv2_lrs_set_pool
  * @{
  */
 #ifndef CONFIG_AODVV2_MAX_ROUTING_ENTRIES
@@ -42,6 +44,82 @@ extern "C" {
 #endif
 /** @} */
 
+/**
+ * @brief   Number of buckets on the Local Route Set hash index
+ *
+ * Lookups walk a single bucket, so keep this close to
+ * @ref CONFIG_AODVV2_MAX_ROUTING_ENTRIES for constant time operations.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_HASH_BUCKETS
+#define CONFIG_AODVV2_LRS_HASH_BUCKETS (16)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of distinct prefix lengths used for longest prefix
+ *          matching
+ *
+ * Routes with a prefix length that doesn't fit are still found by
+ * @ref aodvv2_lrs_lookup, but only by scanning the whole table.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_PFX_LENS
+#define CONFIG_AODVV2_LRS_PFX_LENS (4)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of loop-free alternate next hops per route
+ *
+ * Every alternate adds 18 bytes to each routing entry, see
+ * @ref aodvv2_lrs_entry_size.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_MAX_ALTERNATES
+#define CONFIG_AODVV2_LRS_MAX_ALTERNATES (2)
+#endif
+/** @} */
+
+/**
+ * @brief   Time before the expiration of a route at which a new route
+ *          discovery is started if the route is still in use, in seconds
+ *
+ * Keeps the routes used by steady flows from expiring, so their packets
+ * don't have to wait for a route discovery. Only applies to the routes
+ * enabled through @ref aodvv2_lrs_set_refresh. A route in use is only
+ * noticed once every @ref CONFIG_AODVV2_ACTIVE_INTERVAL, when it goes back
+ * on the NIB, so it should be longer than that. Set to 0 to disable it.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_REFRESH_TIME
+#define CONFIG_AODVV2_LRS_REFRESH_TIME (20)
+#endif
+/** @} */
+
+/**
+ * @brief   Number of destinations that can be marked as used between two
+ *          runs of @ref aodvv2_lrs_timeout, must be a power of two
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_USED_QUEUE_SIZE
+#define CONFIG_AODVV2_LRS_USED_QUEUE_SIZE (8)
+#endif
+/** @} */
+
+/**
+ * @brief   Maximum number of events the AODVv2 thread handles before the
+ *          route changes are applied to the NIB
+ *
+ * Changes are applied as soon as the thread is idle, this bounds how long
+ * they wait while it's kept busy.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_LRS_NIB_SYNC_EVENTS
+#define CONFIG_AODVV2_LRS_NIB_SYNC_EVENTS (8)
+#endif
+/** @} */
+
 /**
  * A route table entry (i.e., a route) may be in one of the following states:
  */
@@ -61,20 +139,125 @@ typedef struct {
     uint8_t pfx_len;              /**< Prefix length */
     aodvv2_seqnum_t seqnum;       /**< SeqNum associated with the IPv6 address */
     ipv6_addr_t next_hop;         /**< Next hop IP address towards the destination */
-    timex_t last_used;            /**< Last time this route was used */
-    timex_t expiration_time;      /**< Time at which this route expires */
+    uint32_t last_used;           /**< Last time this route was used, in ms ticks */
+    uint32_t expiration_time;     /**< Time at which this route expires, in ms ticks */
     routing_metric_t metric_type; /**< Metric type of this route */
     uint8_t metric;               /**< Metric value of this route*/
     uint8_t state;                /**< State of this route */
 } aodvv2_local_route_t;
 
+/**
+ * @brief   Callback for a route whose next hop or state changed
+ *
+ * @param[in] route The changed route.
+ */
+typedef void (*aodvv2_lrs_route_cb_t)(const aodvv2_local_route_t *route);
+
+/**
+ * @brief   Callback for a route in use that is about to expire
+ *
+ * @param[in] route The route to refresh.
+ * @param[in] src   Source of a packet that was sent through the route.
+ */
+typedef void (*aodvv2_lrs_refresh_cb_t)(const aodvv2_local_route_t *route,
+                                        const ipv6_addr_t *src);
+
+/**
+ * @brief   Callback for a packet marked with @ref aodvv2_lrs_mark_used
+ *
+ * @param[in] route The route the packet is sent through, now Active, or NULL
+ *                  if there is no valid route towards @p dst.
+ * @param[in] src   Source of the packet.
+ * @param[in] dst   Destination of the packet.
+ */
+typedef void (*aodvv2_lrs_used_cb_t)(const aodvv2_local_route_t *route,
+                                     const ipv6_addr_t *src,
+                                     const ipv6_addr_t *dst);
+
+/**
+ * @brief   Current time in the millisecond ticks used by the Local Route Set
+ *
+ * The tick count wraps around after ~49 days, timestamps must only be
+ * compared through their difference.
+ */
+static inline uint32_t aodvv2_lrs_now(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+/**
+ * @brief     Size of the pool memory taken by a routing entry.
+ *
+ * @return Size in bytes, multiply it by the desired number of routing entries
+ *         to size the pool given to @ref aodvv2_lrs_set_pool.
+ */
+size_t aodvv2_lrs_entry_size(void);
+
+/**
+ * @brief     Use the given memory to store the Local Route Set.
+ *
+ * Allows the number of routing entries to be chosen at boot time, e.g. a
+ * larger table on relay nodes than on leaf nodes running the same firmware.
+ * Must be called before @ref aodvv2_lrs_init (i.e. before aodvv2_init()),
+ * the table in use can't be replaced. Without it
+ * @ref CONFIG_AODVV2_MAX_ROUTING_ENTRIES entries are used.
+ *
+ * @param[in] pool Memory for the routing entries, it must stay valid.
+ * @param[in] size Size of @p pool in bytes.
+ *
+ * @return 0 on success.
+ * @return -ENOMEM if @p pool can't hold a single entry.
+ * @return -EBUSY if the Local Route Set was already initialized.
+ */
+int aodvv2_lrs_set_pool(void *pool, size_t size);
+
 /**
  * @brief     Initialize Local Route Set.
+ *
+ * @param[in] pid       Thread that receives @ref AODVV2_MSG_TYPE_LRS_TIMEOUT
+ *                      messages, usually the AODVv2 thread.
+ * @param[in] netif_pid Interface of the routes installed on the NIB.
+ */
+void aodvv2_lrs_init(kernel_pid_t pid, kernel_pid_t netif_pid);
+
+/**
+ * @brief     Process the packets marked as used and the route state
+ *            transitions that are due.
+ *
+ * Routes move from Active to Idle, from Idle to Expired, and are expunged
+ * once expired for MAX_SEQNUM_LIFETIME. Must be called from the thread given
+ * to @ref aodvv2_lrs_init when it receives @ref AODVV2_MSG_TYPE_LRS_TIMEOUT,
+ * and after @ref aodvv2_lrs_mark_used.
+ *
+ * @param[in] refresh_cb Called for every route that was used since the last
+ *                       run and needs to be refreshed, see
+ *                       @ref CONFIG_AODVV2_LRS_REFRESH_TIME. May be NULL.
+ * @param[in] used_cb    Called for every packet marked as used since the last
+ *                       run, once its route is Active. May be NULL.
+ */
+void aodvv2_lrs_timeout(aodvv2_lrs_refresh_cb_t refresh_cb,
+                        aodvv2_lrs_used_cb_t used_cb);
+
+/**
+ * @brief     Mark the route towards dst as used by a packet from src.
+ *
+ * Only Active routes are on the NIB forwarding table, so a packet through an
+ * Idle route, or one without a route at all, is reported by the NIB route
+ * info callback. That's where this is meant to be called from. It doesn't
+ * take any lock and only queues the packet's addresses, the routes are
+ * updated on the next run of @ref aodvv2_lrs_timeout. Repeated marks of the
+ * same destination are mostly filtered out before reaching the queue, and
+ * marks that don't fit on it are dropped.
+ *
+ * @note Must only be called from a single thread, the GNRC IPv6 thread.
+ *
+ * @param[in] src Source of the packet.
+ * @param[in] dst Destination of the packet.
  */
-void aodvv2_lrs_init(void);
+void aodvv2_lrs_mark_used(const ipv6_addr_t *src, const ipv6_addr_t *dst);
 
 /**
- * @brief     Get next hop towards dest.
+ * @brief     Get next hop towards dest, using the longest matching route.
  *
  * @param[in] dest        Destination of the packet
  * @param[in] metric_type  Metric Type of the desired route
@@ -86,31 +269,85 @@ ipv6_addr_t *aodvv2_lrs_get_next_hop(ipv6_addr_t *dest,
 
 /**
  * @brief     Add new entry to Local Route, if there is no other entry
- *            to the same destination.
+ *            to the same prefix.
+ *
+ * When the table is full the Expired and Broken routes are evicted first,
+ * oldest first, then the least recently used Idle routes. Active routes are
+ * never evicted.
  *
  * @param[in] entry The Local Route to add.
+ *
+ * @return true if the entry was added, false if the destination is already
+ *         known or the table is full of Active routes.
  */
-void aodvv2_lrs_add_entry(aodvv2_local_route_t *entry);
+bool aodvv2_lrs_add_entry(const aodvv2_local_route_t *entry);
 
 /**
- * @brief     Retrieve pointer to a Local Route entry.
+ * @brief     Store the new data of a Local Route, adding it if the
+ *            destination isn't known yet.
  *
- * @param[in] addr       The address towards which the route should point
- * @param[in] metric_type Metric Type of the desired route
+ * @param[in] entry The Local Route, as filled by
+ *                  @ref aodvv2_lrs_fill_routing_entry_rreq or
+ *                  @ref aodvv2_lrs_fill_routing_entry_rrep.
+ */
+void aodvv2_lrs_update_entry(const aodvv2_local_route_t *entry);
+
+/**
+ * @brief     Refresh the Local Route towards addr before it expires, as long
+ *            as it's in use.
  *
- * @return Local Route if it exists, NULL otherwise
+ * Meant for the routes discovered on behalf of our clients. Has no effect
+ * when @ref CONFIG_AODVV2_LRS_REFRESH_TIME is 0.
+ *
+ * @param[in] addr        The address towards which the route points
+ * @param[in] pfx_len     Prefix length of the route
+ * @param[in] metric_type Metric Type of the route
  */
-aodvv2_local_route_t *aodvv2_lrs_get_entry(ipv6_addr_t *addr,
-                                           routing_metric_t metric_type);
+void aodvv2_lrs_set_refresh(const ipv6_addr_t *addr, uint8_t pfx_len,
+                            routing_metric_t metric_type);
+
+/**
+ * @brief     Retrieve a copy of a Local Route entry.
+ *
+ * Routes are identified by their prefix, so nested prefixes sharing the same
+ * address (e.g. 2001:db8::/32 and 2001:db8::/48) are different routes. The
+ * host bits of @p addr beyond @p pfx_len are ignored.
+ *
+ * @param[in]  addr        The address towards which the route should point
+ * @param[in]  pfx_len     Prefix length of the desired route
+ * @param[in]  metric_type Metric Type of the desired route
+ * @param[out] route       The Local Route, may be NULL
+ *
+ * @return true if the Local Route exists, false otherwise
+ */
+bool aodvv2_lrs_get_entry(const ipv6_addr_t *addr, uint8_t pfx_len,
+                          routing_metric_t metric_type,
+                          aodvv2_local_route_t *route);
+
+/**
+ * @brief     Find the Local Route with the longest prefix containing addr.
+ *
+ * Only Active and Idle routes are considered.
+ *
+ * @param[in]  addr        The address to look up
+ * @param[in]  metric_type Metric Type of the desired route
+ * @param[out] route       The Local Route, may be NULL
+ *
+ * @return true if a Local Route was found, false otherwise
+ */
+bool aodvv2_lrs_lookup(const ipv6_addr_t *addr, routing_metric_t metric_type,
+                       aodvv2_local_route_t *route);
 
 /**
  * @brief     Delete Local Route entry towards addr with metric type MetricType,
  *            if it exists.
  *
- * @param[in] addr       The address towards which the route should point
+ * @param[in] addr        The address towards which the route should point
+ * @param[in] pfx_len     Prefix length of the desired route
  * @param[in] metric_type Metric Type of the desired route
  */
-void aodvv2_lrs_delete_entry(ipv6_addr_t *addr, routing_metric_t metric_type);
+void aodvv2_lrs_delete_entry(const ipv6_addr_t *addr, uint8_t pfx_len,
+                             routing_metric_t metric_type);
 
 /**
  * @brief   Check if the data of a RREQ or RREP offers improvement for an
@@ -121,30 +358,81 @@ void aodvv2_lrs_delete_entry(ipv6_addr_t *addr, routing_metric_t metric_type);
  *
  * @return true if offers improvement, false otherwise.
  */
-bool aodvv2_lrs_offers_improvement(aodvv2_local_route_t *rt_entry,
+bool aodvv2_lrs_offers_improvement(const aodvv2_local_route_t *rt_entry,
                                    node_data_t *node_data);
 
+/**
+ * @brief   Keep the data of a RREQ or RREP that offers no improvement as an
+ *          alternate next hop of an existing Local Route entry.
+ *
+ * Only data with the same SeqNum as the route, received from a neighbor that
+ * is strictly closer to the destination than the current route cost, is kept
+ * so the alternates are loop-free.
+ *
+ * @param[in] rt_entry  The Local Route, as returned by @ref aodvv2_lrs_get_entry.
+ * @param[in] node_data The data of the destination.
+ * @param[in] next_hop  The neighbor that sent the data.
+ * @param[in] link_cost The link cost to the neighbor.
+ *
+ * @return true if the alternate was stored, false otherwise.
+ */
+bool aodvv2_lrs_add_alternate(const aodvv2_local_route_t *rt_entry,
+                              node_data_t *node_data,
+                              const ipv6_addr_t *next_hop, uint8_t link_cost);
+
+/**
+ * @brief   Handle a broken link to a neighbor.
+ *
+ * Routes through @p next_hop switch to their best alternate next hop, or are
+ * marked as Broken if they don't have any. The alternates through
+ * @p next_hop are removed.
+ *
+ * @param[in] next_hop The unreachable neighbor.
+ * @param[in] cb       Called for every route that changed, may be NULL.
+ */
+void aodvv2_lrs_link_broken(const ipv6_addr_t *next_hop,
+                            aodvv2_lrs_route_cb_t cb);
+
+/**
+ * @brief   Apply the pending Local Route changes to the NIB forwarding table.
+ *
+ * Changes to the Local Route Set are queued and applied here in a single
+ * pass: every route that changed since the last sync results in at most one
+ * NIB update, routes keeping their next hop and prefix are updated in place,
+ * and routes that are no longer Active are removed. Routes are installed
+ * without a lifetime, the NIB keeps them until they're removed here.
+ *
+ * Must be called from the thread given to @ref aodvv2_lrs_init.
+ */
+void aodvv2_lrs_nib_sync(void);
+
+/**
+ * @brief   Whether a Local Route is on the NIB forwarding table.
+ *
+ * @param[in] route The Local Route, as returned by @ref aodvv2_lrs_lookup.
+ *
+ * @return true if the route was installed by the last
+ *         @ref aodvv2_lrs_nib_sync, false otherwise.
+ */
+bool aodvv2_lrs_nib_installed(const aodvv2_local_route_t *route);
+
 /**
  * @brief   Fills a Local Route entry with the data of a RREQ.
  *
- * @param[in]  msg       The RREQ's data
+ * @param[in]  msg       The RREQ's data, with the metric already updated
  * @param[out] rt_entry  The Local Route entry to fill
- * @param[in]  link_cost The link cost for this RREQ
  */
 void aodvv2_lrs_fill_routing_entry_rreq(aodvv2_message_t *msg,
-                                        aodvv2_local_route_t *rt_entry,
-                                        uint8_t link_cost);
+                                        aodvv2_local_route_t *rt_entry);
 
 /**
  * @brief   Fills a Local Route entry with the data of a RREP.
  *
- * @param[in]  msg       The RREP's data
+ * @param[in]  msg       The RREP's data, with the metric already updated
  * @param[out] rt_entry  The Local Route entry to fill
- * @param[in]  link_cost The link cost for this RREP
  */
 void aodvv2_lrs_fill_routing_entry_rrep(aodvv2_message_t *msg,
-                                        aodvv2_local_route_t *rt_entry,
-                                        uint8_t link_cost);
+                                        aodvv2_local_route_t *rt_entry);
 
 #ifdef __cplusplus
 } /* extern "C" */
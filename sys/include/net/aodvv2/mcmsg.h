@@ -40,6 +40,27 @@ extern "C" {
 #define CONFIG_AODVV2_MCMSG_MAX_ENTRIES (16)
 #endif
 
+/**
+ * @brief   Number of buckets on the hash index of the set
+ * @{
+ */
+#ifndef CONFIG_AODVV2_MCMSG_HASH_BUCKETS
+#define CONFIG_AODVV2_MCMSG_HASH_BUCKETS (16)
+#endif
+/** @} */
+
+/**
+ * @brief   Number of counters on the Bloom filter in front of the set
+ *
+ * Should be a few times @ref CONFIG_AODVV2_MCMSG_MAX_ENTRIES to keep the
+ * false positive rate low.
+ * @{
+ */
+#ifndef CONFIG_AODVV2_MCMSG_BLOOM_SIZE
+#define CONFIG_AODVV2_MCMSG_BLOOM_SIZE (64)
+#endif
+/** @} */
+
 /**
  * @brief   A Multicast Message
  */
@@ -51,8 +72,8 @@ typedef struct {
     aodvv2_seqnum_t targ_seqnum;  /**< SeqNum associated with TargPrefix */
     routing_metric_t metric_type; /**< Metric type of the RREQ */
     uint8_t metric;               /**< Metric of the RREQ */
-    timex_t timestamp;            /**< Last time this entry was updated */
-    timex_t removal_time;         /**< Time at which this entry should be removed */
+    uint32_t timestamp;           /**< Last time this entry was updated, in ms ticks */
+    uint32_t removal_time;        /**< Time at which this entry should be removed, in ms ticks */
     uint16_t netif;               /**< Interface where this McMsg was received */
     ipv6_addr_t seqnortr;         /**< SeqNoRtr */
 } aodvv2_mcmsg_t;
@@ -77,6 +98,17 @@ void aodvv2_mcmsg_init(void);
  */
 int aodvv2_mcmsg_process(aodvv2_message_t *msg);
 
+/**
+ * @brief   Number of McMsgs evicted to make room for new ones
+ *
+ * When the set is full the least recently updated McMsg is evicted, so a
+ * growing count means @ref CONFIG_AODVV2_MCMSG_MAX_ENTRIES is too small for
+ * the RREQ load and some duplicates may be flooded again.
+ *
+ * @return Evictions since @ref aodvv2_mcmsg_init.
+ */
+uint32_t aodvv2_mcmsg_evictions(void);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
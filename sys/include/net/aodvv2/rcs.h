@@ -82,12 +82,12 @@ void aodvv2_rcs_init(void);
  * address.
  * @param[in] cost          Cost associated with the client.
  *
- * @return NULL The Set is full.
- * @return aodvv2_rcs_entry_t * Pointer to the entry in the client set.
+ * @return 0 on success.
+ * @return -EEXIST The client is already on the set.
+ * @return -ENOSPC The set is full.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_add(const ipv6_addr_t *addr,
-                                   const uint8_t prefix_length,
-                                   const uint8_t cost);
+int aodvv2_rcs_add(const ipv6_addr_t *addr, const uint8_t prefix_length,
+                   const uint8_t cost);
 
 /**
  * @brief   Delete a client from the Router Client Set
@@ -104,25 +104,29 @@ void aodvv2_rcs_del(const ipv6_addr_t *addr, uint8_t pfx_len);
  *
  * @pre @p addr != NULL
  *
- * @param[in] addr    The client address to be found.
- * @param[in] pfx_len `addr` prefix length.
+ * @param[in]  addr    The client address to be found.
+ * @param[in]  pfx_len `addr` prefix length.
+ * @param[out] entry   Copy of the entry, may be NULL.
  *
- * @return Pointer to entry if found.
- * @return NULL Not found.
+ * @return true if found, false otherwise.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_matches(const ipv6_addr_t *addr,
-                                       uint8_t pfx_len);
+bool aodvv2_rcs_matches(const ipv6_addr_t *addr, uint8_t pfx_len,
+                        aodvv2_rcs_entry_t *entry);
 
 /**
  * @brief   Checks if the given IPv6 address matches an entry.
  *
+ * If several entries match, the one with the longest prefix is returned.
+ * Doesn't block unless a client is being added or removed at the same time.
+ *
  * @pre @p addr != NULL
  *
- * @param[in] addr The IPv6 address.
+ * @param[in]  addr  The IPv6 address.
+ * @param[out] entry Copy of the matching entry, may be NULL.
  *
- * @return NULL if not found, otherwise pointer to RCS entry.
+ * @return true if found, false otherwise.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_is_client(const ipv6_addr_t *addr);
+bool aodvv2_rcs_is_client(const ipv6_addr_t *addr, aodvv2_rcs_entry_t *entry);
 
 /**
  * @brief   Print RCS entries.
@@ -24,6 +24,7 @@
 #define NET_AODVV2_RFC5444_H
 
 #include "net/aodvv2/seqnum.h"
+#include "net/gnrc/pkt.h"
 #include "net/manet.h"
 #include "net/metric.h"
 
@@ -58,13 +59,70 @@ extern "C" {
 #define CONFIG_AODVV2_RFC5444_MSG_QUEUE_SIZE (32)
 #endif
 
+/**
+ * @name    RFC5444 thread event queue size, per priority
+ *
+ * Messages are moved from the thread message queue to one queue per
+ * priority, so RREPs are handled before the RREQs waiting to be flooded.
+ * Received packets and RREQs that don't fit on their queue are dropped,
+ * other messages are handled right away.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_EVENT_QUEUE_SIZE
+#define CONFIG_AODVV2_RFC5444_EVENT_QUEUE_SIZE (8)
+#endif
+
 /**
  * @name    RFC5444 maximum packet size
+ *
+ * From its first message until it's sent, a packet takes this much of the
+ * GNRC packet buffer plus a snip, for up to
+ * @ref CONFIG_AODVV2_RFC5444_AGGREGATION_TIME, the jitter and the multicast
+ * rate limit wait. The UDP, IPv6 and netif headers are only added when it's
+ * sent. When the packet buffer can't spare it, the messages are written to a
+ * static buffer of the same size and copied once the packet is complete.
  */
 #ifndef CONFIG_AODVV2_RFC5444_PACKET_SIZE
 #define CONFIG_AODVV2_RFC5444_PACKET_SIZE    (128)
 #endif
 
+/**
+ * @name    RFC5444 aggregation window, in milliseconds
+ *
+ * Messages to the same next hop sent within this time share a single
+ * packet. Set to 0 to send every message on its own packet.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_AGGREGATION_TIME
+#define CONFIG_AODVV2_RFC5444_AGGREGATION_TIME (10)
+#endif
+
+/**
+ * @name    Maximum jitter of multicast RFC5444 packets, in milliseconds
+ *
+ * Multicast packets are delayed by a random time up to this value, as
+ * described in RFC 5148, so neighbors forwarding the same flood don't
+ * collide.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_MAX_JITTER
+#define CONFIG_AODVV2_RFC5444_MAX_JITTER (50)
+#endif
+
+/**
+ * @name    Multicast RFC5444 packets sent per second
+ *
+ * Multicast packets beyond this rate wait, up to two built packets are held
+ * back and the rest is dropped. Set to 0 to disable the rate limit.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_MCAST_RATE
+#define CONFIG_AODVV2_RFC5444_MCAST_RATE (10)
+#endif
+
+/**
+ * @name    Multicast RFC5444 packets that can be sent in a burst
+ */
+#ifndef CONFIG_AODVV2_RFC5444_MCAST_BURST
+#define CONFIG_AODVV2_RFC5444_MCAST_BURST (5)
+#endif
+
 /**
  * @name    RFC5444 address TLVs buffer size
  */
@@ -72,6 +130,60 @@ extern "C" {
 #define CONFIG_AODVV2_RFC5444_ADDR_TLVS_SIZE (1000)
 #endif
 
+/**
+ * @name    RFC5444 TLVs a received message can carry
+ *
+ * The reader keeps the TLVs of the message being parsed, plus the packet
+ * TLVs, in a fixed storage of this size instead of the heap.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_READER_TLVS
+#define CONFIG_AODVV2_RFC5444_READER_TLVS (8)
+#endif
+
+/**
+ * @name    RFC5444 address blocks a received message can carry
+ */
+#ifndef CONFIG_AODVV2_RFC5444_READER_ADDRBLOCKS
+#define CONFIG_AODVV2_RFC5444_READER_ADDRBLOCKS (4)
+#endif
+
+/**
+ * @name    RFC5444 addresses a sent message can carry
+ *
+ * The writer takes the addresses of the message being written from a fixed
+ * pool of this size instead of the heap.
+ */
+#ifndef CONFIG_AODVV2_RFC5444_WRITER_ADDRESSES
+#define CONFIG_AODVV2_RFC5444_WRITER_ADDRESSES (4)
+#endif
+
+/**
+ * @name    RFC5444 address TLVs a sent message can carry
+ */
+#ifndef CONFIG_AODVV2_RFC5444_WRITER_ADDRTLVS
+#define CONFIG_AODVV2_RFC5444_WRITER_ADDRTLVS (8)
+#endif
+
+/**
+ * @name    Allocate RFC5444 addresses and address TLVs from the heap when
+ *          the writer pools are exhausted
+ *
+ * Disabled by default, messages that don't fit aren't sent.
+ */
+#ifdef DOXYGEN
+#define CONFIG_AODVV2_RFC5444_WRITER_HEAP
+#endif
+
+/**
+ * @name    Allocate RFC5444 TLVs and address blocks from the heap when the
+ *          reader storage is exhausted
+ *
+ * Disabled by default, messages that don't fit are dropped.
+ */
+#ifdef DOXYGEN
+#define CONFIG_AODVV2_RFC5444_READER_HEAP
+#endif
+
 /**
  * @brief   AODVv2 message types
  */
@@ -112,12 +224,13 @@ typedef struct {
     node_data_t orig_node;        /**< OrigNode data */
     node_data_t targ_node;        /**< TargNode data */
     ipv6_addr_t seqnortr;         /**< SeqNoRtr */
-    timex_t timestamp;            /**< Time at which the message was received */
+    uint32_t timestamp;           /**< Time at which the message was received, in ms ticks */
 } aodvv2_message_t;
 
 typedef struct {
     struct rfc5444_writer_target target; /**< RFC5444 writer target */
     ipv6_addr_t target_addr;             /**< Address where the packet will be sent */
+    gnrc_pktsnip_t *payload;             /**< Payload of the packet being written */
 } aodvv2_writer_target_t;
 
 #ifdef __cplusplus
@@ -21,8 +21,13 @@
  * @}
  */
 
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+
 #include "net/aodvv2.h"
 #include "net/aodvv2/rfc5444.h"
+#include "net/aodvv2/discovery.h"
 #include "net/aodvv2/lrs.h"
 #include "net/aodvv2/mcmsg.h"
 #include "net/aodvv2/metric.h"
@@ -30,10 +35,13 @@
 #include "net/aodvv2/seqnum.h"
 
 #include "net/gnrc/ipv6.h"
+#include "net/gnrc/ipv6/nib.h"
 #include "net/gnrc/udp.h"
 #include "net/gnrc/netif/hdr.h"
 
+#include "bitarithm.h"
 #include "mutex.h"
+#include "random.h"
 
 #include "aodvv2_reader.h"
 #include "aodvv2_writer.h"
@@ -67,12 +75,28 @@ static gnrc_netif_t *_netif;
 static gnrc_netreg_entry_t netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
                                                                KERNEL_PID_UNDEF);
 
+/**
+ * @brief   Whether an @ref AODVV2_MSG_TYPE_ROUTE_USED message is on its way,
+ *          the packets marked as used meanwhile are handled by it too
+ */
+static atomic_bool _route_used_pending;
+
 /**
  * @brief   The RFC5444 packet reader context
  */
-static struct rfc5444_reader _reader;
+static aodvv2_reader_t _reader;
 static mutex_t _reader_lock;
 
+/**
+ * @brief   Maximum number of payload snips of a received packet
+ */
+#define READER_IOV_MAX (4)
+
+/**
+ * @brief   Copy of the messages that span two payload snips
+ */
+static uint8_t _reader_bounce[CONFIG_AODVV2_RFC5444_PACKET_SIZE];
+
 /**
  * @brief   The RFC5444 packet writer context
  */
@@ -81,8 +105,161 @@ static aodvv2_writer_target_t _writer_context;
 static uint8_t _writer_msg_buffer[CONFIG_AODVV2_RFC5444_PACKET_SIZE];
 static uint8_t _writer_msg_addrtlvs[CONFIG_AODVV2_RFC5444_ADDR_TLVS_SIZE];
 static uint8_t _writer_pkt_buffer[CONFIG_AODVV2_RFC5444_PACKET_SIZE];
+static struct rfc5444_writer_address _writer_addresses[CONFIG_AODVV2_RFC5444_WRITER_ADDRESSES];
+static struct rfc5444_writer_addrtlv _writer_addrtlvs[CONFIG_AODVV2_RFC5444_WRITER_ADDRTLVS];
+static struct rfc5444_writer_message _writer_messages[AODVV2_WRITER_MESSAGES];
 static mutex_t _writer_lock;
 
+/**
+ * @brief   Aggregation window timer, armed while messages wait on the writer
+ */
+static xtimer_t _writer_timer;
+static msg_t _writer_timer_msg;
+static bool _writer_pending;
+
+/**
+ * @brief   Token bucket of the multicast packets, in thousandths of a packet
+ */
+static uint32_t _mcast_tokens = CONFIG_AODVV2_RFC5444_MCAST_BURST * 1000UL;
+static uint32_t _mcast_last;
+
+/**
+ * @brief   Maximum number of built multicast packets waiting for a token
+ */
+#define MCAST_QUEUE_SIZE (2)
+
+/**
+ * @brief   Multicast packets that had to be sent before a token was
+ *          available, oldest first
+ */
+static gnrc_pktsnip_t *_mcast_queue[MCAST_QUEUE_SIZE];
+static unsigned _mcast_queued;
+static xtimer_t _mcast_timer;
+static msg_t _mcast_timer_msg;
+
+#if CONFIG_AODVV2_MSG_POOL_SIZE < 1 || CONFIG_AODVV2_MSG_POOL_SIZE > 32
+#error "CONFIG_AODVV2_MSG_POOL_SIZE must be between 1 and 32"
+#endif
+
+/**
+ * @brief   Messages queued for the AODVv2 thread
+ *
+ * A set bit on @ref _msg_pool_used marks the entry as taken, so entries are
+ * taken and returned from any thread without locking.
+ */
+static aodvv2_msg_t _msg_pool[CONFIG_AODVV2_MSG_POOL_SIZE];
+static atomic_uint _msg_pool_used;
+
+#define MSG_POOL_FULL ((CONFIG_AODVV2_MSG_POOL_SIZE == 32) ? UINT32_MAX : \
+                       ((1UL << CONFIG_AODVV2_MSG_POOL_SIZE) - 1))
+
+static aodvv2_msg_t *_msg_alloc(void)
+{
+    unsigned used = atomic_load(&_msg_pool_used);
+    unsigned i;
+
+    do {
+        if (used == MSG_POOL_FULL) {
+            return NULL;
+        }
+        i = bitarithm_lsb(~used);
+    } while (!atomic_compare_exchange_weak(&_msg_pool_used, &used,
+                                           used | (1U << i)));
+
+    return &_msg_pool[i];
+}
+
+static void _msg_free(aodvv2_msg_t *msg)
+{
+    unsigned i = msg - _msg_pool;
+    assert(i < ARRAY_SIZE(_msg_pool));
+
+    atomic_fetch_and(&_msg_pool_used, ~(1U << i));
+}
+
+static int _msg_send(uint16_t type, const aodvv2_message_t *pkt,
+                     const ipv6_addr_t *next_hop, bool block)
+{
+    aodvv2_msg_t *msg = _msg_alloc();
+    if (msg == NULL) {
+        DEBUG("aodvv2: message pool exhausted!\n");
+        return -ENOBUFS;
+    }
+
+    msg->next_hop = *next_hop;
+    if (pkt != NULL) {
+        msg->pkt = *pkt;
+    }
+
+    msg_t ipc_msg;
+    ipc_msg.content.ptr = msg;
+    ipc_msg.type = type;
+
+    int res = block ? msg_send(&ipc_msg, _pid) : msg_try_send(&ipc_msg, _pid);
+    if (res < 1) {
+        _msg_free(msg);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void _link_broken(const ipv6_addr_t *next_hop)
+{
+    /* The NIB may be locked here, so let the AODVv2 thread handle it */
+    if (_msg_send(AODVV2_MSG_TYPE_LINK_BROKEN, NULL, next_hop, false) < 0) {
+        DEBUG("aodvv2: couldn't notify broken link.\n");
+    }
+}
+
+static void _route_refresh(const aodvv2_local_route_t *route,
+                           const ipv6_addr_t *src)
+{
+    /* Only routes used by our clients are ours to refresh, packets we're
+     * just forwarding are refreshed by their own router */
+    if (!aodvv2_rcs_is_client(src, NULL)) {
+        return;
+    }
+
+    DEBUG_PUTS("aodvv2: route about to expire, starting route discovery");
+    if (aodvv2_discovery_start(src, &route->addr) < 0) {
+        DEBUG_PUTS("aodvv2: couldn't refresh route");
+    }
+}
+
+/*
+ * A packet buffered by the route info callback, now that the LRS was checked
+ */
+static void _route_used(const aodvv2_local_route_t *route,
+                        const ipv6_addr_t *src, const ipv6_addr_t *dst)
+{
+    if (route != NULL) {
+        /* The route has to be on the NIB before its packets are sent
+         * again, otherwise they'd come right back here */
+        aodvv2_lrs_nib_sync();
+        if (aodvv2_lrs_nib_installed(route)) {
+            aodvv2_buffer_dispatch(&route->addr, route->pfx_len);
+        }
+        else {
+            DEBUG_PUTS("aodvv2: couldn't install route, dropping packets");
+            aodvv2_buffer_drop(dst);
+        }
+        return;
+    }
+
+    if (!aodvv2_rcs_is_client(src, NULL)) {
+        DEBUG_PUTS("aodvv2: no route and src is not our client!");
+        aodvv2_buffer_drop(dst);
+        return;
+    }
+
+    DEBUG_PUTS("aodvv2: finding route");
+    if (aodvv2_discovery_start(src, dst) < 0) {
+        DEBUG_PUTS("aodvv2: destination is unreachable!");
+        aodvv2_buffer_drop(dst);
+    }
+}
+
 static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
                         const void *ctx)
 {
@@ -97,17 +274,22 @@ static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
                 gnrc_pktsnip_t *pkt = (gnrc_pktsnip_t *)ctx;
                 ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
 
-                if (aodvv2_rcs_is_client(&ipv6_hdr->src) != NULL) {
-                    if (aodvv2_buffer_pkt_add(ctx_addr, pkt) == 0) {
-                        DEBUG("aodvv2: finding route\n");
-                        aodvv2_find_route(&ipv6_hdr->src, ctx_addr);
-                    }
-                    else {
-                        DEBUG("aodvv2: couldn't buffer packet!\n");
-                    }
+                /* Only Active routes are on the NIB, this packet may be
+                 * using an Idle one or need a route discovery. The LRS
+                 * belongs to the AODVv2 thread, so keep the packet and let
+                 * it decide. */
+                if (ipv6_hdr == NULL ||
+                    aodvv2_buffer_pkt_add(ctx_addr, pkt) != 0) {
+                    DEBUG("aodvv2: couldn't buffer packet!\n");
+                    break;
                 }
-                else {
-                    DEBUG("aodvv2: src is not our client!\n");
+
+                aodvv2_lrs_mark_used(&ipv6_hdr->src, ctx_addr);
+                if (!atomic_exchange(&_route_used_pending, true)) {
+                    msg_t msg = { .type = AODVV2_MSG_TYPE_ROUTE_USED };
+                    if (msg_try_send(&msg, _pid) < 1) {
+                        atomic_store(&_route_used_pending, false);
+                    }
                 }
             }
             break;
@@ -118,6 +300,10 @@ static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
 
         case GNRC_IPV6_NIB_ROUTE_INFO_TYPE_NSC:
             DEBUG("aodvv2: GNRC_IPV6_NIB_ROUTE_INFO_TYPE_NSC\n");
+            if ((uintptr_t)ctx == GNRC_IPV6_NIB_NC_INFO_NUD_STATE_UNREACHABLE) {
+                DEBUG("aodvv2: neighbor is unreachable\n");
+                _link_broken(ctx_addr);
+            }
             break;
 
         default:
@@ -126,6 +312,134 @@ static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
     }
 }
 
+static void _mcast_refill(void)
+{
+    uint32_t now = aodvv2_lrs_now();
+    uint32_t elapsed = now - _mcast_last;
+    uint32_t max = CONFIG_AODVV2_RFC5444_MCAST_BURST * 1000UL;
+
+    _mcast_last = now;
+
+    /* Enough to fill the bucket, avoids overflowing below */
+    if (elapsed > max) {
+        elapsed = max;
+    }
+
+    _mcast_tokens += elapsed * CONFIG_AODVV2_RFC5444_MCAST_RATE;
+    if (_mcast_tokens > max) {
+        _mcast_tokens = max;
+    }
+}
+
+/*
+ * Time until num multicast packets can be sent, in ms. More than a burst
+ * only waits for a full bucket.
+ */
+static uint32_t _mcast_wait(unsigned num)
+{
+    if (CONFIG_AODVV2_RFC5444_MCAST_RATE == 0) {
+        return 0;
+    }
+
+    uint32_t needed = num * 1000UL;
+    if (needed > CONFIG_AODVV2_RFC5444_MCAST_BURST * 1000UL) {
+        needed = CONFIG_AODVV2_RFC5444_MCAST_BURST * 1000UL;
+    }
+
+    _mcast_refill();
+    if (_mcast_tokens >= needed) {
+        return 0;
+    }
+
+    return ((needed - _mcast_tokens) + CONFIG_AODVV2_RFC5444_MCAST_RATE - 1) /
+           CONFIG_AODVV2_RFC5444_MCAST_RATE;
+}
+
+static bool _mcast_take(void)
+{
+    if (CONFIG_AODVV2_RFC5444_MCAST_RATE == 0) {
+        return true;
+    }
+
+    _mcast_refill();
+    if (_mcast_tokens < 1000) {
+        return false;
+    }
+
+    _mcast_tokens -= 1000;
+    return true;
+}
+
+/*
+ * Point the writer to next_hop, the messages to the previous one are sent
+ * first as they can't share a packet. Call with _writer_lock held.
+ */
+static void _writer_begin(const ipv6_addr_t *next_hop)
+{
+    if (_writer_pending &&
+        !ipv6_addr_equal(&_writer_context.target_addr, next_hop)) {
+        /* A multicast packet without a token is held back by
+         * _send_packet() */
+        xtimer_remove(&_writer_timer);
+        _writer_pending = false;
+        rfc5444_writer_flush(&_writer, &_writer_context.target, false);
+    }
+
+    _writer_context.target_addr = *next_hop;
+}
+
+/*
+ * Send the packet now or at the end of the aggregation window. Multicast
+ * packets also wait for a random jitter and for the rate limit. Call with
+ * _writer_lock held.
+ */
+static void _writer_end(void)
+{
+    uint32_t delay = CONFIG_AODVV2_RFC5444_AGGREGATION_TIME;
+
+    if (ipv6_addr_is_multicast(&_writer_context.target_addr)) {
+        delay += random_uint32_range(0, CONFIG_AODVV2_RFC5444_MAX_JITTER + 1);
+        delay += _mcast_wait(_mcast_queued + 1);
+    }
+
+    if (delay == 0) {
+        rfc5444_writer_flush(&_writer, &_writer_context.target, false);
+        return;
+    }
+
+    if (!_writer_pending) {
+        _writer_pending = true;
+        _writer_timer_msg.type = AODVV2_MSG_TYPE_WRITER_FLUSH;
+        xtimer_set_msg(&_writer_timer, delay * US_PER_MS, &_writer_timer_msg,
+                       _pid);
+    }
+}
+
+static void _writer_flush(void)
+{
+    mutex_lock(&_writer_lock);
+
+    if (!_writer_pending) {
+        mutex_unlock(&_writer_lock);
+        return;
+    }
+
+    /* The tokens may have been taken since the timer was set */
+    if (ipv6_addr_is_multicast(&_writer_context.target_addr)) {
+        uint32_t wait = _mcast_wait(_mcast_queued + 1);
+        if (wait > 0) {
+            xtimer_set_msg(&_writer_timer, wait * US_PER_MS,
+                           &_writer_timer_msg, _pid);
+            mutex_unlock(&_writer_lock);
+            return;
+        }
+    }
+
+    rfc5444_writer_flush(&_writer, &_writer_context.target, false);
+    _writer_pending = false;
+    mutex_unlock(&_writer_lock);
+}
+
 static void _send_rreq(aodvv2_message_t *message, ipv6_addr_t *next_hop)
 {
     assert(message != NULL);
@@ -133,11 +447,11 @@ static void _send_rreq(aodvv2_message_t *message, ipv6_addr_t *next_hop)
 
     /* Make sure no other thread is using the writer right now */
     mutex_lock(&_writer_lock);
-    _writer_context.target_addr = *next_hop;
+    _writer_begin(next_hop);
 
     aodvv2_writer_send_rreq(&_writer, message);
 
-    rfc5444_writer_flush(&_writer, &_writer_context.target, false);
+    _writer_end();
     mutex_unlock(&_writer_lock);
 }
 
@@ -148,14 +462,98 @@ static void _send_rrep(aodvv2_message_t *message, ipv6_addr_t *next_hop)
 
     /* Make sure no other thread is using the writer right now */
     mutex_lock(&_writer_lock);
-    _writer_context.target_addr = *next_hop;
+    _writer_begin(next_hop);
 
     aodvv2_writer_send_rrep(&_writer, message);
 
-    rfc5444_writer_flush(&_writer, &_writer_context.target, false);
+    _writer_end();
     mutex_unlock(&_writer_lock);
 }
 
+/*
+ * Add the UDP, IPv6 and netif headers to payload, releases it on failure
+ */
+static gnrc_pktsnip_t *_build_headers(gnrc_pktsnip_t *payload,
+                                      const ipv6_addr_t *dst)
+{
+    gnrc_pktsnip_t *udp;
+    gnrc_pktsnip_t *ip;
+
+    /* Build UDP packet */
+    uint16_t port = UDP_MANET_PORT;
+    udp = gnrc_udp_hdr_build(payload, port, port);
+    if (udp == NULL) {
+        DEBUG("aodvv2: unable to allocate UDP header\n");
+        gnrc_pktbuf_release(payload);
+        return NULL;
+    }
+
+    /* Build IPv6 header */
+    ip = gnrc_ipv6_hdr_build(udp, NULL, dst);
+    if (ip == NULL) {
+        DEBUG("aodvv2: unable to allocate IPv6 header\n");
+        gnrc_pktbuf_release(udp);
+        return NULL;
+    }
+
+    /* Build netif header */
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG("aodvv2: unable to allocate netif header\n");
+        gnrc_pktbuf_release(ip);
+        return NULL;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    LL_PREPEND(ip, netif_hdr);
+
+    return ip;
+}
+
+static void _dispatch(gnrc_pktsnip_t *pkt)
+{
+    int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP,
+                                        GNRC_NETREG_DEMUX_CTX_ALL, pkt);
+    if (res < 1) {
+        DEBUG("aodvv2: unable to locate UDP thread\n");
+        gnrc_pktbuf_release(pkt);
+    }
+}
+
+static void _release_packet(aodvv2_writer_target_t *ctx)
+{
+    if (ctx->payload != NULL) {
+        gnrc_pktbuf_release(ctx->payload);
+        ctx->payload = NULL;
+    }
+}
+
+/*
+ * Reserve the payload before the writer starts the packet, so the messages
+ * are serialized directly on it. It's held until the packet is sent, the
+ * headers are only added then.
+ */
+static void *_alloc_packet(struct rfc5444_writer *writer,
+                           struct rfc5444_writer_target *iface)
+{
+    (void)writer;
+
+    aodvv2_writer_target_t *ctx = container_of(iface, aodvv2_writer_target_t,
+                                               target);
+
+    /* The previous packet wasn't sent */
+    _release_packet(ctx);
+
+    gnrc_pktsnip_t *payload = gnrc_pktbuf_add(NULL, NULL, iface->packet_size,
+                                              GNRC_NETTYPE_UNDEF);
+    if (payload == NULL) {
+        DEBUG("aodvv2: couldn't reserve packet, using writer buffer\n");
+        return NULL;
+    }
+
+    ctx->payload = payload;
+    return payload->data;
+}
+
 static void _send_packet(struct rfc5444_writer *writer,
                          struct rfc5444_writer_target *iface, void *buffer,
                          size_t length)
@@ -181,53 +579,111 @@ static void _send_packet(struct rfc5444_writer *writer,
 
     aodvv2_writer_target_t *ctx = container_of(iface, aodvv2_writer_target_t,
                                                target);
-
     gnrc_pktsnip_t *payload;
-    gnrc_pktsnip_t *udp;
-    gnrc_pktsnip_t *ip;
 
-    /* Generate our pktsnip with our RFC5444 message */
-    payload = gnrc_pktbuf_add(NULL, buffer, length, GNRC_NETTYPE_UNDEF);
-    if (payload == NULL) {
-        DEBUG("aodvv2: couldn't allocate payload\n");
-        return;
+    if (ctx->payload != NULL && ctx->payload->data == buffer) {
+        /* Written in place, only trim the unused room */
+        payload = ctx->payload;
+        ctx->payload = NULL;
+        if (gnrc_pktbuf_realloc_data(payload, length) != 0) {
+            DEBUG("aodvv2: couldn't trim payload\n");
+            gnrc_pktbuf_release(payload);
+            return;
+        }
     }
+    else {
+        /* Written on the writer buffer, copy it */
+        _release_packet(ctx);
 
-    /* Build UDP packet */
-    uint16_t port = UDP_MANET_PORT;
-    udp = gnrc_udp_hdr_build(payload, port, port);
-    if (udp == NULL) {
-        DEBUG("aodvv2: unable to allocate UDP header\n");
-        gnrc_pktbuf_release(payload);
+        payload = gnrc_pktbuf_add(NULL, buffer, length, GNRC_NETTYPE_UNDEF);
+        if (payload == NULL) {
+            DEBUG("aodvv2: couldn't allocate payload\n");
+            return;
+        }
+    }
+
+    gnrc_pktsnip_t *pkt = _build_headers(payload, &ctx->target_addr);
+    if (pkt == NULL) {
         return;
     }
 
-    /* Build IPv6 header */
-    ip = gnrc_ipv6_hdr_build(udp, NULL, &ctx->target_addr);
-    if (ip == NULL) {
-        DEBUG("aodvv2: unable to allocate IPv6 header\n");
-        gnrc_pktbuf_release(udp);
+    if (!ipv6_addr_is_multicast(&ctx->target_addr)) {
+        _dispatch(pkt);
         return;
     }
 
-    /* Build netif header */
-    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
-    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
-    LL_PREPEND(ip, netif_hdr);
+    /* Keep the order of the multicast packets held back */
+    if (_mcast_queued == 0 && _mcast_take()) {
+        _dispatch(pkt);
+        return;
+    }
 
-    /* Send packet */
-    int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP,
-                                        GNRC_NETREG_DEMUX_CTX_ALL, ip);
-    if (res < 1) {
-        DEBUG("aodvv2: unable to locate UDP thread\n");
-        gnrc_pktbuf_release(ip);
+    if (_mcast_queued == ARRAY_SIZE(_mcast_queue)) {
+        DEBUG("aodvv2: multicast rate limit reached, dropping packet\n");
+        gnrc_pktbuf_release(pkt);
         return;
     }
+
+    _mcast_queue[_mcast_queued++] = pkt;
+    if (_mcast_queued == 1) {
+        _mcast_timer_msg.type = AODVV2_MSG_TYPE_MCAST_SEND;
+        xtimer_set_msg(&_mcast_timer, _mcast_wait(1) * US_PER_MS,
+                       &_mcast_timer_msg, _pid);
+    }
+}
+
+/*
+ * Send the held back multicast packets there are tokens for
+ */
+static void _mcast_send_queued(void)
+{
+    mutex_lock(&_writer_lock);
+
+    unsigned sent = 0;
+    while (sent < _mcast_queued && _mcast_take()) {
+        _dispatch(_mcast_queue[sent++]);
+    }
+
+    _mcast_queued -= sent;
+    memmove(&_mcast_queue[0], &_mcast_queue[sent],
+            _mcast_queued * sizeof(_mcast_queue[0]));
+
+    if (_mcast_queued > 0) {
+        xtimer_set_msg(&_mcast_timer, _mcast_wait(1) * US_PER_MS,
+                       &_mcast_timer_msg, _pid);
+    }
+
+    mutex_unlock(&_writer_lock);
 }
 
 static void _receive(gnrc_pktsnip_t *pkt)
 {
-    assert(pkt != NULL && pkt->data != NULL && pkt->size > 0);
+    assert(pkt != NULL);
+
+    /* The payload may be split in several snips, they come before the
+     * UDP header */
+    struct rfc5444_reader_iovec iov[READER_IOV_MAX];
+    size_t iovcnt = 0;
+    gnrc_pktsnip_t *snip;
+    for (snip = pkt; snip != NULL && snip->type != GNRC_NETTYPE_UDP;
+         snip = snip->next) {
+        if (iovcnt == ARRAY_SIZE(iov)) {
+            DEBUG("aodvv2: too many payload snips, dropping packet\n");
+            gnrc_pktbuf_release(pkt);
+            return;
+        }
+        iov[iovcnt].data = snip->data;
+        iov[iovcnt].length = snip->size;
+        iovcnt++;
+    }
+
+    /* Anything that didn't come through the UDP netreg isn't ours */
+    ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
+    if (snip == NULL || ipv6_hdr == NULL) {
+        DEBUG("aodvv2: not an RFC5444 packet, dropping it\n");
+        gnrc_pktbuf_release(pkt);
+        return;
+    }
 
 #if ENABLE_DEBUG == 1
     static struct autobuf hexbuf;
@@ -244,13 +700,12 @@ static void _receive(gnrc_pktsnip_t *pkt)
 
     /* Find sender address on IPv6 header */
     ipv6_addr_t sender;
-    ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
-    assert(ipv6_hdr != NULL);
     memcpy(&sender, &ipv6_hdr->src, sizeof(ipv6_addr_t));
 
     mutex_lock(&_reader_lock);
-    aodvv2_rfc5444_handle_packet_prepare(&sender);
-    if (rfc5444_reader_handle_packet(&_reader, pkt->data, pkt->size) != RFC5444_OKAY) {
+    if (aodvv2_reader_handle_packet(&_reader, &sender, iov, iovcnt,
+                                    _reader_bounce,
+                                    sizeof(_reader_bounce)) != RFC5444_OKAY) {
         DEBUG("aodvv2: couldn't handle packet!\n");
     }
     mutex_unlock(&_reader_lock);
@@ -258,58 +713,241 @@ static void _receive(gnrc_pktsnip_t *pkt)
     gnrc_pktbuf_release(pkt);
 }
 
-static void *_event_loop(void *arg)
+/**
+ * @brief   Priority of the events handled by the AODVv2 thread
+ */
+enum {
+    EVENT_PRIO_HIGH,   /**< RREPs, link breaks and timers */
+    EVENT_PRIO_NORMAL, /**< Received packets */
+    EVENT_PRIO_LOW,    /**< RREQ flooding */
+    EVENT_PRIO_NUMOF,
+};
+
+typedef struct {
+    msg_t msgs[CONFIG_AODVV2_RFC5444_EVENT_QUEUE_SIZE]; /**< Events */
+    uint8_t head;                                       /**< Oldest event */
+    uint8_t num;                                        /**< Number of events */
+    uint16_t overflows;                                 /**< Events that didn't fit */
+} prio_queue_t;
+
+/**
+ * @brief   Events received but not handled yet, by priority
+ */
+static prio_queue_t _events[EVENT_PRIO_NUMOF];
+static unsigned _events_num;
+
+static unsigned _event_prio(uint16_t type)
 {
-    (void)arg;
-    msg_t msg;
-    msg_t reply;
-    msg_t msg_queue[CONFIG_AODVV2_RFC5444_MSG_QUEUE_SIZE];
+    switch (type) {
+        case AODVV2_MSG_TYPE_SEND_RREQ:
+            return EVENT_PRIO_LOW;
 
-    /* Initialize message queue */
-    msg_init_queue(msg_queue, CONFIG_AODVV2_RFC5444_MSG_QUEUE_SIZE);
+        case GNRC_NETAPI_MSG_TYPE_RCV:
+        case GNRC_NETAPI_MSG_TYPE_SND:
+            return EVENT_PRIO_NORMAL;
+
+        default:
+            return EVENT_PRIO_HIGH;
+    }
+}
+
+static bool _event_push(const msg_t *msg, unsigned prio)
+{
+    prio_queue_t *queue = &_events[prio];
+    if (queue->num == ARRAY_SIZE(queue->msgs)) {
+        return false;
+    }
+
+    queue->msgs[(queue->head + queue->num) % ARRAY_SIZE(queue->msgs)] = *msg;
+    queue->num++;
+    _events_num++;
+    return true;
+}
+
+static void _event_pop(msg_t *msg)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_events); i++) {
+        prio_queue_t *queue = &_events[i];
+        if (queue->num == 0) {
+            continue;
+        }
+
+        *msg = queue->msgs[queue->head];
+        queue->head = (queue->head + 1) % ARRAY_SIZE(queue->msgs);
+        queue->num--;
+        _events_num--;
+        return;
+    }
+}
+
+static void _event_handle(msg_t *msg)
+{
+    msg_t reply;
 
     reply.content.value = (uint32_t)(-ENOTSUP);
     reply.type = GNRC_NETAPI_MSG_TYPE_ACK;
 
-    while (1) {
-        msg_receive(&msg);
+    switch (msg->type) {
+        case AODVV2_MSG_TYPE_SEND_RREQ:
+            DEBUG("AODVV2_MSG_TYPE_SEND_RREQ\n");
+            {
+                aodvv2_msg_t *m = msg->content.ptr;
+                _send_rreq(&m->pkt, &m->next_hop);
+                _msg_free(m);
+            }
+            break;
 
-        switch (msg.type) {
-            case AODVV2_MSG_TYPE_SEND_RREQ:
-                DEBUG("AODVV2_MSG_TYPE_SEND_RREQ\n");
-                {
-                    aodvv2_msg_t m;
-                    memcpy(&m, (aodvv2_msg_t *)msg.content.ptr, sizeof(m));
-                    free(msg.content.ptr);
+        case AODVV2_MSG_TYPE_SEND_RREP:
+            DEBUG("AODVV2_MSG_TYPE_SEND_RREP\n");
+            {
+                aodvv2_msg_t *m = msg->content.ptr;
+                _send_rrep(&m->pkt, &m->next_hop);
+                _msg_free(m);
+            }
+            break;
 
-                    _send_rreq(&m.pkt, &m.next_hop);
-                }
-                break;
+        case AODVV2_MSG_TYPE_LINK_BROKEN:
+            DEBUG("AODVV2_MSG_TYPE_LINK_BROKEN\n");
+            {
+                aodvv2_msg_t *m = msg->content.ptr;
+                aodvv2_lrs_link_broken(&m->next_hop, NULL);
+                _msg_free(m);
+            }
+            break;
 
-            case AODVV2_MSG_TYPE_SEND_RREP:
-                DEBUG("AODVV2_MSG_TYPE_SEND_RREP\n");
-                {
-                    aodvv2_msg_t m;
-                    memcpy(&m, (aodvv2_msg_t *)msg.content.ptr, sizeof(m));
-                    free(msg.content.ptr);
+        case AODVV2_MSG_TYPE_BUFFER_TIMEOUT:
+            DEBUG("AODVV2_MSG_TYPE_BUFFER_TIMEOUT\n");
+            aodvv2_buffer_timeout();
+            break;
 
-                    _send_rrep(&m.pkt, &m.next_hop);
-                }
-                break;
+        case AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT:
+            DEBUG("AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT\n");
+            aodvv2_discovery_timeout();
+            break;
+
+        case AODVV2_MSG_TYPE_WRITER_FLUSH:
+            DEBUG("AODVV2_MSG_TYPE_WRITER_FLUSH\n");
+            _writer_flush();
+            break;
+
+        case AODVV2_MSG_TYPE_MCAST_SEND:
+            DEBUG("AODVV2_MSG_TYPE_MCAST_SEND\n");
+            _mcast_send_queued();
+            break;
+
+        case AODVV2_MSG_TYPE_LRS_TIMEOUT:
+            DEBUG("AODVV2_MSG_TYPE_LRS_TIMEOUT\n");
+            aodvv2_lrs_timeout(_route_refresh, _route_used);
+            break;
+
+        case AODVV2_MSG_TYPE_ROUTE_USED:
+            DEBUG("AODVV2_MSG_TYPE_ROUTE_USED\n");
+            /* Marks arriving from now on need a new message */
+            atomic_store(&_route_used_pending, false);
+            aodvv2_lrs_timeout(_route_refresh, _route_used);
+            break;
+
+        case GNRC_NETAPI_MSG_TYPE_RCV:
+            DEBUG("GNRC_NETAPI_MSG_TYPE_RCV\n");
+            _receive((gnrc_pktsnip_t *)msg->content.ptr);
+            break;
+
+        case GNRC_NETAPI_MSG_TYPE_SND:
+            DEBUG("aodvv2: unexpected GNRC_NETAPI_MSG_TYPE_SND\n");
+            gnrc_pktbuf_release(msg->content.ptr);
+            break;
+
+        case GNRC_NETAPI_MSG_TYPE_GET:
+        case GNRC_NETAPI_MSG_TYPE_SET:
+            msg_reply(msg, &reply);
+            break;
+
+        default:
+            DEBUG("aodvv2: received unidentified message\n");
+            break;
+    }
+}
+
+/*
+ * Release what an event that won't be handled holds
+ */
+static void _event_drop(msg_t *msg)
+{
+    switch (msg->type) {
+        case AODVV2_MSG_TYPE_SEND_RREQ:
+            _msg_free(msg->content.ptr);
+            break;
+
+        case GNRC_NETAPI_MSG_TYPE_RCV:
+        case GNRC_NETAPI_MSG_TYPE_SND:
+            gnrc_pktbuf_release(msg->content.ptr);
+            break;
 
-            case GNRC_NETAPI_MSG_TYPE_RCV:
-                DEBUG("GNRC_NETAPI_MSG_TYPE_RCV\n");
-                _receive((gnrc_pktsnip_t *)msg.content.ptr);
-                break;
+        default:
+            break;
+    }
+}
 
-            case GNRC_NETAPI_MSG_TYPE_GET:
-            case GNRC_NETAPI_MSG_TYPE_SET:
-                msg_reply(&msg, &reply);
-                break;
+/*
+ * Queue msg on the queue of its priority. An event that doesn't fit is
+ * handled right away if it has the highest priority, which keeps it ahead
+ * of everything else, otherwise it's dropped.
+ */
+static void _event_add(msg_t *msg)
+{
+    unsigned prio = _event_prio(msg->type);
+    if (_event_push(msg, prio)) {
+        return;
+    }
 
-            default:
-                DEBUG("aodvv2: received unidentified message\n");
-                break;
+    _events[prio].overflows++;
+    if (prio == EVENT_PRIO_HIGH) {
+        _event_handle(msg);
+        return;
+    }
+
+    DEBUG("aodvv2: event queue %u full, dropping event (%u so far)\n", prio,
+          (unsigned)_events[prio].overflows);
+    _event_drop(msg);
+}
+
+static void *_event_loop(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+    msg_t msg_queue[CONFIG_AODVV2_RFC5444_MSG_QUEUE_SIZE];
+    unsigned nib_sync_events = 0;
+
+    /* Initialize message queue */
+    msg_init_queue(msg_queue, CONFIG_AODVV2_RFC5444_MSG_QUEUE_SIZE);
+
+    while (1) {
+        if (_events_num == 0) {
+            msg_receive(&msg);
+            _event_add(&msg);
+        }
+
+        /* Sort what arrived meanwhile by priority */
+        while (msg_try_receive(&msg) == 1) {
+            _event_add(&msg);
+        }
+
+        if (_events_num == 0) {
+            continue;
+        }
+
+        /* An RREP unblocks buffered data, so it goes before flooding the
+         * RREQs that piled up */
+        _event_pop(&msg);
+        _event_handle(&msg);
+
+        /* Apply the route changes once there's nothing else to process, so
+         * a burst of messages results in a single update per route, but
+         * don't let them wait for too long while messages keep coming */
+        if ((_events_num == 0 && msg_avail() == 0) ||
+            ++nib_sync_events >= CONFIG_AODVV2_LRS_NIB_SYNC_EVENTS) {
+            aodvv2_lrs_nib_sync();
+            nib_sync_events = 0;
         }
     }
 
@@ -344,10 +982,11 @@ int aodvv2_init(gnrc_netif_t *netif)
 
     /* Initialize AODVv2 internal structures */
     aodvv2_seqnum_init();
-    aodvv2_lrs_init();
+    aodvv2_lrs_init(_pid, _netif->pid);
     aodvv2_rcs_init();
     aodvv2_mcmsg_init();
-    aodvv2_buffer_init();
+    aodvv2_buffer_init(_pid);
+    aodvv2_discovery_init(_pid);
 
     /* Register netreg */
     gnrc_netreg_entry_init_pid(&netreg, UDP_MANET_PORT, _pid);
@@ -356,11 +995,8 @@ int aodvv2_init(gnrc_netif_t *netif)
     /* Initialize RFC5444 reader */
     mutex_lock(&_reader_lock);
 
-    /* Initialize reader */
-    rfc5444_reader_init(&_reader);
-
-    /* Register AODVv2 messages reader */
-    aodvv2_reader_init(&_reader, _netif->pid);
+    /* Initialize reader and register the AODVv2 messages consumers */
+    aodvv2_reader_init(&_reader);
 
     mutex_unlock(&_reader_lock);
 
@@ -372,11 +1008,24 @@ int aodvv2_init(gnrc_netif_t *netif)
     _writer.addrtlv_buffer = _writer_msg_addrtlvs;
     _writer.addrtlv_size = sizeof(_writer_msg_addrtlvs);
 
+    /* Keep the writer objects off the heap */
+    _writer.address_pool.entries = _writer_addresses;
+    _writer.address_pool.count = ARRAY_SIZE(_writer_addresses);
+    _writer.address_pool.heap_fallback =
+        IS_ACTIVE(CONFIG_AODVV2_RFC5444_WRITER_HEAP);
+    _writer.addrtlv_pool.entries = _writer_addrtlvs;
+    _writer.addrtlv_pool.count = ARRAY_SIZE(_writer_addrtlvs);
+    _writer.addrtlv_pool.heap_fallback =
+        IS_ACTIVE(CONFIG_AODVV2_RFC5444_WRITER_HEAP);
+    _writer.message_pool.entries = _writer_messages;
+    _writer.message_pool.count = ARRAY_SIZE(_writer_messages);
+
     /* Define target for generating rfc5444 packets */
     _writer_context.target.packet_buffer = _writer_pkt_buffer;
     _writer_context.target.packet_size = sizeof(_writer_pkt_buffer);
 
-    /* Set function to send binary packet content */
+    /* Set functions to reserve and send the packets */
+    _writer_context.target.allocPacket = _alloc_packet;
     _writer_context.target.sendPacket = _send_packet;
 
     /* Initialize writer */
@@ -400,61 +1049,27 @@ int aodvv2_init(gnrc_netif_t *netif)
 int aodvv2_send_rreq(aodvv2_message_t *pkt,
                      ipv6_addr_t *next_hop)
 {
-    aodvv2_msg_t *msg = malloc(sizeof(aodvv2_msg_t));
-    if (msg == NULL) {
-        DEBUG("aodvv2: out of memory!\n");
-        return -1;
-    }
-
-    /* Set destination address */
-    memcpy(&msg->next_hop, next_hop, sizeof(ipv6_addr_t));
-
-    /* Copy RREQ packet */
-    memcpy(&msg->pkt, pkt, sizeof(aodvv2_message_t));
-
-    /* Prepare and send IPC message */
-    msg_t ipc_msg;
-    ipc_msg.content.ptr = msg;
-    ipc_msg.type = AODVV2_MSG_TYPE_SEND_RREQ;
-
-    if (msg_send(&ipc_msg, _pid) < 1) {
+    int res = _msg_send(AODVV2_MSG_TYPE_SEND_RREQ, pkt, next_hop, true);
+    if (res < 0) {
         DEBUG("aodvv2: couldn't send RREQ.\n");
-        return -1;
     }
 
-    return 0;
+    return res;
 }
 
 int aodvv2_send_rrep(aodvv2_message_t *pkt,
                      ipv6_addr_t *next_hop)
 {
-    aodvv2_msg_t *msg = malloc(sizeof(aodvv2_msg_t));
-    if (msg == NULL) {
-        DEBUG("aodvv2: out of memory!\n");
-        return -1;
+    int res = _msg_send(AODVV2_MSG_TYPE_SEND_RREP, pkt, next_hop, true);
+    if (res < 0) {
+        DEBUG("aodvv2: couldn't send RREP.\n");
     }
 
-    /* Set destination address */
-    memcpy(&msg->next_hop, next_hop, sizeof(ipv6_addr_t));
-
-    /* Copy RREQ packet */
-    memcpy(&msg->pkt, pkt, sizeof(aodvv2_message_t));
-
-    /* Prepare and send IPC message */
-    msg_t ipc_msg;
-    ipc_msg.content.ptr = msg;
-    ipc_msg.type = AODVV2_MSG_TYPE_SEND_RREP;
-
-    if (msg_send(&ipc_msg, _pid) < 1) {
-        DEBUG("aodvv2: couldn't send RREQ.\n");
-        return -1;
-    }
-
-    return 0;
+    return res;
 }
 
 int aodvv2_find_route(const ipv6_addr_t *orig_addr,
-                      const ipv6_addr_t *target_addr)
+                      const ipv6_addr_t *target_addr, uint8_t hop_limit)
 {
     assert(orig_addr != NULL && target_addr != NULL);
 
@@ -462,13 +1077,16 @@ int aodvv2_find_route(const ipv6_addr_t *orig_addr,
 
     /* Set metric information */
     pkt.msg_hop_limit = aodvv2_metric_max(METRIC_HOP_COUNT);
+    if (hop_limit != 0 && hop_limit < pkt.msg_hop_limit) {
+        pkt.msg_hop_limit = hop_limit;
+    }
     pkt.metric_type = CONFIG_AODVV2_DEFAULT_METRIC;
 
     /* Set OrigNode information */
-    aodvv2_rcs_entry_t *client;
-    if ((client = aodvv2_rcs_is_client(orig_addr)) != NULL) {
-        pkt.orig_node.addr = client->addr;
-        pkt.orig_node.pfx_len = client->pfx_len;
+    aodvv2_rcs_entry_t client;
+    if (aodvv2_rcs_is_client(orig_addr, &client)) {
+        pkt.orig_node.addr = client.addr;
+        pkt.orig_node.pfx_len = client.pfx_len;
     }
     else {
         DEBUG_PUTS("aodvv2: not a client");
@@ -17,80 +17,328 @@
  * @}
  */
 
+#include <errno.h>
 #include <stdbool.h>
 
 #include "net/aodvv2.h"
+#include "net/aodvv2/lrs.h"
 #include "net/gnrc/pktbuf.h"
 #include "net/gnrc/ipv6.h"
 
+#include "mutex.h"
+#include "xtimer.h"
+
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-#define CONFIG_AODVV2_MAX_BUFFERED_PACKETS (10)
+/**
+ * @brief   Index of a packet or a destination
+ */
+typedef uint8_t buf_idx_t;
+
+/**
+ * @brief   Invalid @ref buf_idx_t, used to terminate the lists
+ */
+#define BUF_IDX_NONE (UINT8_MAX)
+
+#if CONFIG_AODVV2_MAX_BUFFERED_PACKETS >= UINT8_MAX
+#error "CONFIG_AODVV2_MAX_BUFFERED_PACKETS must be lower than 255"
+#endif
+
+#if CONFIG_AODVV2_BUFFER_MAX_DESTS >= UINT8_MAX
+#error "CONFIG_AODVV2_BUFFER_MAX_DESTS must be lower than 255"
+#endif
+
+#if CONFIG_AODVV2_BUFFER_MAX_PER_DEST > UINT8_MAX
+#error "CONFIG_AODVV2_BUFFER_MAX_PER_DEST must not exceed 255"
+#endif
+
+/**
+ * @brief   Time a destination waits for a route, in ms
+ */
+#define BUF_WAIT_TIME (AODVV2_DISCOVERY_TIME * MS_PER_SEC)
 
 typedef struct {
-    bool used;
-    gnrc_pktsnip_t *pkt;
-    ipv6_addr_t dst;
+    gnrc_pktsnip_t *pkt; /**< Packet */
+    uint16_t len;        /**< Length of the packet */
+    buf_idx_t next;      /**< Next packet on the queue or the free list */
 } buffered_pkt_t;
 
+typedef struct {
+    ipv6_addr_t dst;  /**< Destination address */
+    uint32_t expires; /**< Time at which the packets are dropped, in ms */
+    buf_idx_t head;   /**< Oldest packet, BUF_IDX_NONE if unused */
+    buf_idx_t tail;   /**< Newest packet */
+    uint8_t num;      /**< Number of packets */
+} buffered_dst_t;
+
 static buffered_pkt_t _buffered_pkts[CONFIG_AODVV2_MAX_BUFFERED_PACKETS];
+static buffered_dst_t _dsts[CONFIG_AODVV2_BUFFER_MAX_DESTS];
+static buf_idx_t _free_head;
+static size_t _bytes;
+static mutex_t _lock = MUTEX_INIT;
+
+static xtimer_t _timer;
+static msg_t _timer_msg;
+static kernel_pid_t _timer_pid = KERNEL_PID_UNDEF;
+
+static inline bool _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
 
-static void _pkt_del(unsigned i)
+/*
+ * Unlink the oldest packet of destination d, the caller owns it afterwards
+ */
+static gnrc_pktsnip_t *_dst_pop(buffered_dst_t *d)
 {
+    buf_idx_t i = d->head;
     buffered_pkt_t *entry = &_buffered_pkts[i];
-    if (entry->used) {
-        entry->used = false;
-        entry->pkt = NULL;
-        entry->dst = ipv6_addr_unspecified;
+    gnrc_pktsnip_t *pkt = entry->pkt;
+
+    d->head = entry->next;
+    d->num--;
+    _bytes -= entry->len;
+
+    entry->pkt = NULL;
+    entry->next = _free_head;
+    _free_head = i;
+
+    return pkt;
+}
+
+static void _dst_drop_oldest(buffered_dst_t *d)
+{
+    DEBUG_PUTS("aodvv2: dropping oldest buffered packet");
+    gnrc_pktbuf_release(_dst_pop(d));
+}
+
+static void _dst_drop(buffered_dst_t *d)
+{
+    while (d->head != BUF_IDX_NONE) {
+        _dst_drop_oldest(d);
     }
 }
 
-void aodvv2_buffer_init(void)
+/*
+ * The destination that started waiting first, and so expires first
+ */
+static buffered_dst_t *_oldest_dst(void)
 {
+    buffered_dst_t *oldest = NULL;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        buffered_dst_t *d = &_dsts[i];
+        if (d->head == BUF_IDX_NONE) {
+            continue;
+        }
+        if (oldest == NULL || _before(d->expires, oldest->expires)) {
+            oldest = d;
+        }
+    }
+
+    return oldest;
+}
+
+static void _timer_update(void)
+{
+    buffered_dst_t *oldest = _oldest_dst();
+
+    if (oldest == NULL || _timer_pid == KERNEL_PID_UNDEF) {
+        xtimer_remove(&_timer);
+        return;
+    }
+
+    uint32_t now = aodvv2_lrs_now();
+    uint64_t offset = 0;
+    if (_before(now, oldest->expires)) {
+        offset = (uint64_t)(oldest->expires - now) * US_PER_MS;
+    }
+
+    _timer_msg.type = AODVV2_MSG_TYPE_BUFFER_TIMEOUT;
+    xtimer_set_msg64(&_timer, offset, &_timer_msg, _timer_pid);
+}
+
+void aodvv2_buffer_init(kernel_pid_t pid)
+{
+    mutex_lock(&_lock);
+
+    xtimer_remove(&_timer);
+    _timer_pid = pid;
+
     memset(_buffered_pkts, 0, sizeof(_buffered_pkts));
+    memset(_dsts, 0, sizeof(_dsts));
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
+        _buffered_pkts[i].next = (i + 1 < ARRAY_SIZE(_buffered_pkts))
+                               ? (buf_idx_t)(i + 1) : BUF_IDX_NONE;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        _dsts[i].head = BUF_IDX_NONE;
+    }
+    _free_head = 0;
+    _bytes = 0;
+
+    mutex_unlock(&_lock);
 }
 
 int aodvv2_buffer_pkt_add(const ipv6_addr_t *dst, gnrc_pktsnip_t *pkt)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
-        buffered_pkt_t *entry = &_buffered_pkts[i];
-        /* Find free spot */
-        if (!entry->used) {
-            entry->used = true;
-            entry->pkt = pkt;
-            memcpy(&entry->dst, dst, sizeof(ipv6_addr_t));
-
-            /* Increase reference count for this packet as we'll l store it
-             * until we find a route to send it (or not, and release the
-             * packet) */
-            gnrc_pktbuf_hold(entry->pkt, 1);
-
-            return 0;
+    assert(dst != NULL && pkt != NULL);
+
+    size_t len = gnrc_pkt_len(pkt);
+    if (len > CONFIG_AODVV2_BUFFER_MAX_BYTES) {
+        return -ENOSPC;
+    }
+
+    mutex_lock(&_lock);
+
+    /* Find the queue of this destination, or a free one */
+    buffered_dst_t *d = NULL;
+    buffered_dst_t *free_dst = NULL;
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        if (_dsts[i].head == BUF_IDX_NONE) {
+            if (free_dst == NULL) {
+                free_dst = &_dsts[i];
+            }
+        }
+        else if (ipv6_addr_equal(&_dsts[i].dst, dst)) {
+            d = &_dsts[i];
+            break;
+        }
+    }
+
+    if (d == NULL) {
+        if (free_dst == NULL) {
+            DEBUG_PUTS("aodvv2: too many destinations, dropping oldest");
+            free_dst = _oldest_dst();
+            _dst_drop(free_dst);
+        }
+
+        d = free_dst;
+        d->dst = *dst;
+        d->expires = aodvv2_lrs_now() + BUF_WAIT_TIME;
+        d->tail = BUF_IDX_NONE;
+        d->num = 0;
+    }
+    else if (d->num == CONFIG_AODVV2_BUFFER_MAX_PER_DEST) {
+        _dst_drop_oldest(d);
+    }
+
+    /* Make room, the oldest packets go first */
+    while (_free_head == BUF_IDX_NONE ||
+           (_bytes + len) > CONFIG_AODVV2_BUFFER_MAX_BYTES) {
+        buffered_dst_t *oldest = (d->head != BUF_IDX_NONE) ? d : NULL;
+        for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+            buffered_dst_t *other = &_dsts[i];
+            if (other != d && other->head != BUF_IDX_NONE &&
+                (oldest == NULL || _before(other->expires, oldest->expires))) {
+                oldest = other;
+            }
+        }
+        _dst_drop_oldest(oldest);
+    }
+
+    buf_idx_t i = _free_head;
+    buffered_pkt_t *entry = &_buffered_pkts[i];
+    _free_head = entry->next;
+
+    entry->pkt = pkt;
+    entry->len = len;
+    entry->next = BUF_IDX_NONE;
+
+    if (d->head == BUF_IDX_NONE) {
+        d->head = i;
+    }
+    else {
+        _buffered_pkts[d->tail].next = i;
+    }
+    d->tail = i;
+    d->num++;
+    _bytes += len;
+
+    /* Increase reference count for this packet as we'll l store it
+     * until we find a route to send it (or not, and release the
+     * packet) */
+    gnrc_pktbuf_hold(pkt, 1);
+
+    _timer_update();
+    mutex_unlock(&_lock);
+
+    return 0;
+}
+
+void aodvv2_buffer_drop(const ipv6_addr_t *dst)
+{
+    assert(dst != NULL);
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        buffered_dst_t *d = &_dsts[i];
+        if (d->head != BUF_IDX_NONE && ipv6_addr_equal(&d->dst, dst)) {
+            DEBUG_PUTS("aodvv2: dropping buffered packets");
+            _dst_drop(d);
         }
     }
+    _timer_update();
+    mutex_unlock(&_lock);
+}
+
+void aodvv2_buffer_timeout(void)
+{
+    uint32_t now = aodvv2_lrs_now();
 
-    /* List of buffered packets is _full_ :/ */
-    return -1;
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        buffered_dst_t *d = &_dsts[i];
+        if (d->head != BUF_IDX_NONE && !_before(now, d->expires)) {
+            DEBUG_PUTS("aodvv2: no route found, dropping buffered packets");
+            _dst_drop(d);
+        }
+    }
+    _timer_update();
+    mutex_unlock(&_lock);
 }
 
-void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr)
+void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr, uint8_t pfx_len)
 {
     assert(targ_addr != NULL);
 
-    for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
-        buffered_pkt_t *entry = &_buffered_pkts[i];
+    if (pfx_len == 0 || pfx_len > 128) {
+        pfx_len = 128;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_dsts); i++) {
+        buffered_dst_t *d = &_dsts[i];
+
+        mutex_lock(&_lock);
+        if (d->head == BUF_IDX_NONE ||
+            ipv6_addr_match_prefix(&d->dst, targ_addr) < pfx_len) {
+            mutex_unlock(&_lock);
+            continue;
+        }
+
+        /* Send them in order without holding the lock, the IPv6 thread may
+         * be waiting on it to buffer another packet */
+        ipv6_addr_t dst = d->dst;
+        while (d->head != BUF_IDX_NONE && ipv6_addr_equal(&d->dst, &dst)) {
+            gnrc_pktsnip_t *pkt = _dst_pop(d);
+            mutex_unlock(&_lock);
 
-        if (ipv6_addr_equal(&entry->dst, targ_addr)) {
             int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6,
                                                 GNRC_NETREG_DEMUX_CTX_ALL,
-                                                entry->pkt);
-
+                                                pkt);
             if (res < 1) {
                 DEBUG("aodvv2: couldn't dispatch packet!\n");
+                gnrc_pktbuf_release(pkt);
             }
-            _pkt_del(i);
+
+            mutex_lock(&_lock);
         }
+        mutex_unlock(&_lock);
     }
-}
 
+    mutex_lock(&_lock);
+    _timer_update();
+    mutex_unlock(&_lock);
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       AODVv2 pending route discoveries
+ *
+ * @author      Jean Pierre Dudey <jeandudey@hotmail.com>
+ * @}
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "net/aodvv2.h"
+#include "net/aodvv2/conf.h"
+#include "net/aodvv2/discovery.h"
+#include "net/aodvv2/lrs.h"
+
+#include "kernel_defines.h"
+#include "mutex.h"
+#include "xtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+#if CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX < 1 || \
+    CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX > 16
+#error "CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX must be between 1 and 16"
+#endif
+
+#if CONFIG_AODVV2_RING_HOP_LIMIT_STEP < 1
+#error "CONFIG_AODVV2_RING_HOP_LIMIT_STEP must be greater than 0"
+#endif
+
+#if CONFIG_AODVV2_RING_HOP_LIMIT_START > CONFIG_AODVV2_RING_HOP_LIMIT_THRESHOLD
+#error "CONFIG_AODVV2_RING_HOP_LIMIT_START must not exceed CONFIG_AODVV2_RING_HOP_LIMIT_THRESHOLD"
+#endif
+
+/**
+ * @brief   State of a route discovery
+ */
+enum {
+    DISCOVERY_STATE_UNUSED,   /**< Free entry */
+    DISCOVERY_STATE_PENDING,  /**< Waiting for a RREP */
+    DISCOVERY_STATE_HOLDDOWN, /**< Failed, no new RREQs are sent */
+};
+
+typedef struct {
+    ipv6_addr_t target; /**< Address we want a route to */
+    ipv6_addr_t orig;   /**< Client that requested the route */
+    uint32_t deadline;  /**< Time of the next state change, in ms */
+    uint8_t attempts;   /**< Number of RREQs sent */
+    uint8_t state;      /**< State of the route discovery */
+} pending_discovery_t;
+
+static pending_discovery_t _pending[CONFIG_AODVV2_DISCOVERY_MAX_PENDING];
+static mutex_t _lock = MUTEX_INIT;
+
+static xtimer_t _timer;
+static msg_t _timer_msg;
+static kernel_pid_t _timer_pid = KERNEL_PID_UNDEF;
+
+static inline bool _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+/*
+ * Time to wait for a RREP after the given attempt, doubles on every attempt
+ */
+static inline uint32_t _wait_time(uint8_t attempts)
+{
+    return (CONFIG_AODVV2_RREQ_WAIT_TIME * MS_PER_SEC) << (attempts - 1);
+}
+
+uint8_t aodvv2_discovery_hop_limit(uint8_t attempts)
+{
+    if (!IS_ACTIVE(CONFIG_AODVV2_EXPANDING_RING) ||
+        attempts >= CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX) {
+        return 0;
+    }
+
+    unsigned hop_limit = CONFIG_AODVV2_RING_HOP_LIMIT_START +
+                         ((attempts - 1) * CONFIG_AODVV2_RING_HOP_LIMIT_STEP);
+    if (hop_limit > CONFIG_AODVV2_RING_HOP_LIMIT_THRESHOLD) {
+        return 0;
+    }
+
+    return hop_limit;
+}
+
+static void _timer_update(void)
+{
+    pending_discovery_t *next = NULL;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_pending); i++) {
+        pending_discovery_t *entry = &_pending[i];
+        if (entry->state == DISCOVERY_STATE_UNUSED) {
+            continue;
+        }
+        if (next == NULL || _before(entry->deadline, next->deadline)) {
+            next = entry;
+        }
+    }
+
+    if (next == NULL || _timer_pid == KERNEL_PID_UNDEF) {
+        xtimer_remove(&_timer);
+        return;
+    }
+
+    uint32_t now = aodvv2_lrs_now();
+    uint64_t offset = 0;
+    if (_before(now, next->deadline)) {
+        offset = (uint64_t)(next->deadline - now) * US_PER_MS;
+    }
+
+    _timer_msg.type = AODVV2_MSG_TYPE_DISCOVERY_TIMEOUT;
+    xtimer_set_msg64(&_timer, offset, &_timer_msg, _timer_pid);
+}
+
+void aodvv2_discovery_init(kernel_pid_t pid)
+{
+    mutex_lock(&_lock);
+    xtimer_remove(&_timer);
+    _timer_pid = pid;
+    memset(_pending, 0, sizeof(_pending));
+    mutex_unlock(&_lock);
+}
+
+int aodvv2_discovery_start(const ipv6_addr_t *orig_addr,
+                           const ipv6_addr_t *target_addr)
+{
+    assert(orig_addr != NULL && target_addr != NULL);
+
+    pending_discovery_t *slot = NULL;
+    uint32_t now = aodvv2_lrs_now();
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_pending); i++) {
+        pending_discovery_t *entry = &_pending[i];
+
+        /* A holddown that is over only waits for the timer to free it */
+        if (entry->state == DISCOVERY_STATE_UNUSED ||
+            (entry->state == DISCOVERY_STATE_HOLDDOWN &&
+             !_before(now, entry->deadline))) {
+            if (slot == NULL) {
+                slot = entry;
+            }
+            continue;
+        }
+
+        if (ipv6_addr_equal(&entry->target, target_addr)) {
+            int res = 0;
+            if (entry->state == DISCOVERY_STATE_HOLDDOWN) {
+                DEBUG_PUTS("aodvv2: destination is held down");
+                res = -EHOSTUNREACH;
+            }
+            else {
+                DEBUG_PUTS("aodvv2: route discovery already in flight");
+            }
+            mutex_unlock(&_lock);
+            return res;
+        }
+    }
+
+    /* Dropping a discovery in flight would strand its buffered packets, and
+     * dropping a holddown would defeat it */
+    if (slot == NULL) {
+        DEBUG_PUTS("aodvv2: too many route discoveries");
+        mutex_unlock(&_lock);
+        return -ENOSPC;
+    }
+
+    slot->state = DISCOVERY_STATE_PENDING;
+    slot->target = *target_addr;
+    slot->orig = *orig_addr;
+    slot->attempts = 1;
+    slot->deadline = now + _wait_time(slot->attempts);
+    _timer_update();
+    mutex_unlock(&_lock);
+
+    int res = aodvv2_find_route(orig_addr, target_addr,
+                                aodvv2_discovery_hop_limit(1));
+    if (res < 0) {
+        DEBUG_PUTS("aodvv2: couldn't send RREQ");
+
+        mutex_lock(&_lock);
+        if (slot->state == DISCOVERY_STATE_PENDING &&
+            ipv6_addr_equal(&slot->target, target_addr)) {
+            slot->state = DISCOVERY_STATE_UNUSED;
+            _timer_update();
+        }
+        mutex_unlock(&_lock);
+        return res;
+    }
+
+    return 1;
+}
+
+void aodvv2_discovery_done(const ipv6_addr_t *targ_addr, uint8_t pfx_len)
+{
+    assert(targ_addr != NULL);
+
+    if (pfx_len == 0 || pfx_len > 128) {
+        pfx_len = 128;
+    }
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_pending); i++) {
+        pending_discovery_t *entry = &_pending[i];
+
+        if (entry->state != DISCOVERY_STATE_UNUSED &&
+            ipv6_addr_match_prefix(&entry->target, targ_addr) >= pfx_len) {
+            DEBUG_PUTS("aodvv2: route discovery done");
+            entry->state = DISCOVERY_STATE_UNUSED;
+        }
+    }
+    _timer_update();
+    mutex_unlock(&_lock);
+}
+
+void aodvv2_discovery_timeout(void)
+{
+    uint32_t now = aodvv2_lrs_now();
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_pending); i++) {
+        pending_discovery_t *entry = &_pending[i];
+
+        mutex_lock(&_lock);
+        if (entry->state == DISCOVERY_STATE_UNUSED ||
+            _before(now, entry->deadline)) {
+            mutex_unlock(&_lock);
+            continue;
+        }
+
+        ipv6_addr_t target = entry->target;
+        ipv6_addr_t orig = entry->orig;
+
+        if (entry->state == DISCOVERY_STATE_HOLDDOWN) {
+            DEBUG_PUTS("aodvv2: holddown is over");
+            entry->state = DISCOVERY_STATE_UNUSED;
+            mutex_unlock(&_lock);
+        }
+        else if (entry->attempts < CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX) {
+            uint8_t attempts = ++entry->attempts;
+            entry->deadline = now + _wait_time(attempts);
+            mutex_unlock(&_lock);
+
+            DEBUG("aodvv2: no RREP, retrying (attempt %u)\n",
+                  (unsigned)attempts);
+            if (aodvv2_find_route(&orig, &target,
+                                  aodvv2_discovery_hop_limit(attempts)) < 0) {
+                DEBUG_PUTS("aodvv2: couldn't send RREQ");
+            }
+        }
+        else {
+            entry->state = DISCOVERY_STATE_HOLDDOWN;
+            entry->deadline = now +
+                              (CONFIG_AODVV2_RREQ_HOLDDOWN_TIME * MS_PER_SEC);
+            mutex_unlock(&_lock);
+
+            DEBUG_PUTS("aodvv2: route discovery failed, holding down");
+            aodvv2_buffer_drop(&target);
+        }
+    }
+
+    mutex_lock(&_lock);
+    _timer_update();
+    mutex_unlock(&_lock);
+}
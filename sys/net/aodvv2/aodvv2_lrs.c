@@ -19,209 +19,1260 @@
  * @author      Jean Pierre Dudey <jeandudey@hotmail.com>
  */
 
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "net/aodvv2.h"
 #include "net/aodvv2/conf.h"
 #include "net/aodvv2/lrs.h"
+#include "net/aodvv2/metric.h"
+#include "net/gnrc/ipv6/nib.h"
+
+#include "xtimer.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-static void _reset_entry_if_stale(uint8_t i);
+#if CONFIG_AODVV2_LRS_REFRESH_TIME >= AODVV2_ROUTE_LIFETIME
+#error "CONFIG_AODVV2_LRS_REFRESH_TIME must be lower than the route lifetime"
+#endif
+
+#if (CONFIG_AODVV2_LRS_USED_QUEUE_SIZE & (CONFIG_AODVV2_LRS_USED_QUEUE_SIZE - 1)) != 0
+#error "CONFIG_AODVV2_LRS_USED_QUEUE_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief   Index of an entry on the routing table
+ */
+typedef uint16_t lrs_idx_t;
+
+/**
+ * @brief   Invalid @ref lrs_idx_t, used to terminate the chains
+ */
+#define LRS_IDX_NONE (UINT16_MAX)
 
 /**
- * @brief   Container for @ref aodvv2_local_route_t
+ * @brief   State of an unused entry
+ */
+#define LRS_STATE_UNUSED (UINT8_MAX)
+
+/**
+ * @brief   Flags of a route
+ * @{
+ */
+#define LRS_FLAG_REFRESH      (0x01) /**< Refresh the route before it expires */
+#define LRS_FLAG_REFRESH_SENT (0x02) /**< The refresh was already requested */
+#define LRS_FLAG_NIB_INSTALLED (0x04) /**< The route is on the NIB */
+#define LRS_FLAG_NIB_PENDING  (0x08) /**< The route is waiting for a NIB sync */
+#define LRS_FLAG_NIB_STALE    (0x10) /**< The NIB has an old next hop */
+#define LRS_FLAG_PFX_INDEXED  (0x20) /**< pfx_len is on the prefix length table */
+/** @} */
+
+/**
+ * @brief   Lookup key of a Local Route
  *
- * This wraps the Local Route and adds an `used` field to check if the entry is
- * in use on the storage array.
+ * These are the only fields touched while walking the hash index, so they're
+ * kept apart from the rest of the route to keep the walk cache friendly.
+ * The `next` field chains the entry either on its hash bucket (when used) or
+ * on the free list (when `state` is @ref LRS_STATE_UNUSED).
+ */
+typedef struct {
+    ipv6_addr_t addr;    /**< Destination IPv6 address */
+    uint8_t pfx_len;     /**< Prefix length */
+    uint8_t metric_type; /**< Metric type of this route */
+    uint8_t state;       /**< State of this route */
+    lrs_idx_t next;      /**< Next entry on the same chain */
+} lrs_key_t;
+
+/**
+ * @brief   Data of a Local Route, only accessed once the route was found
+ */
+typedef struct {
+    ipv6_addr_t next_hop;        /**< Next hop IP address */
+    uint32_t last_used;          /**< Last time this route was used */
+    uint32_t expiration_time;    /**< Time at which this route expires */
+    aodvv2_seqnum_t seqnum;      /**< SeqNum associated with the address */
+    lrs_idx_t heap_pos;          /**< Position on the deadline queue */
+    uint8_t metric;              /**< Metric value of this route */
+    uint8_t alts_num;            /**< Number of alternates */
+    uint8_t flags;               /**< Route flags, LRS_FLAG_* */
+    /** Alternate next hops, sorted by metric */
+    ipv6_addr_t alt_hops[CONFIG_AODVV2_LRS_MAX_ALTERNATES];
+    /** Metrics advertised by the alternate next hops */
+    uint8_t alt_adv_metrics[CONFIG_AODVV2_LRS_MAX_ALTERNATES];
+    /** Metrics of the route through the alternate next hops */
+    uint8_t alt_metrics[CONFIG_AODVV2_LRS_MAX_ALTERNATES];
+} lrs_data_t;
+
+/**
+ * @brief   Memory for the Routing Entries Set, all arrays are indexed by
+ *          @ref lrs_idx_t and have `_capacity` entries
+ *
+ * They're carved out of the pool given to aodvv2_lrs_set_pool(), or out of
+ * `_default_pool`, in the order of @ref lrs_default_pool_t.
+ */
+static lrs_key_t *_keys;
+static lrs_data_t *_data;
+static unsigned _capacity;
+
+/**
+ * @brief   Layout of the pool for @ref CONFIG_AODVV2_MAX_ROUTING_ENTRIES
  */
 typedef struct {
-    aodvv2_local_route_t route; /**< Local Route */
-    bool used; /**< Is this entry used? */
-} lrs_entry_t;
+    lrs_key_t keys[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+    lrs_data_t data[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+    lrs_idx_t heap[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+    lrs_idx_t nib_pending[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+} lrs_default_pool_t;
+
+static lrs_default_pool_t _default_pool;
+static void *_pool = &_default_pool;
+static size_t _pool_size = sizeof(_default_pool);
+
+/**
+ * @brief   Hash index keyed on (address, prefix length, metric type)
+ */
+static lrs_idx_t _buckets[CONFIG_AODVV2_LRS_HASH_BUCKETS];
+
+/**
+ * @brief   First unused entry on the routing table
+ */
+static lrs_idx_t _free_head;
 
 /**
- * @brief   Memory for the Routing Entries Set
+ * @brief   A prefix length in use by the routes on the table
  */
-static lrs_entry_t routing_table[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+typedef struct {
+    uint8_t pfx_len; /**< Prefix length */
+    lrs_idx_t refs; /**< Number of routes using it */
+} lrs_pfx_len_t;
 
-static timex_t null_time;
-static timex_t max_seqnum_lifetime;
-static timex_t active_interval;
-static timex_t max_idletime;
-static timex_t validity_t;
-static timex_t now;
+/**
+ * @brief   Prefix lengths in use, sorted longest first
+ *
+ * A longest prefix match probes the hash index once for each of these.
+ */
+static lrs_pfx_len_t _pfx_lens[CONFIG_AODVV2_LRS_PFX_LENS];
+static unsigned _pfx_lens_num;
 
-void aodvv2_lrs_init(void)
+/**
+ * @brief   Number of routes whose prefix length didn't fit on `_pfx_lens`,
+ *          a longest prefix match has to scan the table for them
+ */
+static unsigned _pfx_unindexed;
+
+/**
+ * @brief   Deadline queue, a binary min-heap ordered by _deadline()
+ */
+static lrs_idx_t *_heap;
+static unsigned _heap_len;
+
+/**
+ * @brief   Timer for the earliest deadline, sends a message to the AODVv2
+ *          thread when it fires
+ */
+static xtimer_t _timer;
+static msg_t _timer_msg;
+static kernel_pid_t _timer_pid = KERNEL_PID_UNDEF;
+
+/**
+ * @brief   Routes waiting to be synchronized with the NIB forwarding table
+ */
+static lrs_idx_t *_nib_pending;
+static unsigned _nib_pending_num;
+static kernel_pid_t _netif_pid = KERNEL_PID_UNDEF;
+
+/**
+ * @brief   A packet sent through a route
+ */
+typedef struct {
+    ipv6_addr_t src; /**< Source of the packet */
+    ipv6_addr_t dst; /**< Destination of the packet */
+} lrs_used_t;
+
+/**
+ * @brief   Packets marked as used, a single producer single consumer
+ *          ring written by @ref aodvv2_lrs_mark_used and drained by the
+ *          AODVv2 thread.
+ *
+ * `_used_head` and `_used_tail` are free running counters.
+ */
+static lrs_used_t _used[CONFIG_AODVV2_LRS_USED_QUEUE_SIZE];
+static atomic_uint _used_head;
+static atomic_uint _used_tail;
+
+/**
+ * @brief   Destinations queued since the last drain, one bit per hash value
+ *
+ * Keeps a flow from filling the queue with the same destination.
+ */
+static atomic_uint_least32_t _used_filter;
+
+static uint32_t max_seqnum_lifetime;
+static uint32_t active_interval;
+static uint32_t validity_t;
+static uint32_t refresh_time;
+
+static unsigned _hash(const ipv6_addr_t *addr, uint8_t pfx_len,
+                      routing_metric_t metric_type)
 {
-    DEBUG("aodvv2_lrs_init()\n");
+    uint32_t h = addr->u32[0].u32 ^ addr->u32[1].u32 ^
+                 addr->u32[2].u32 ^ addr->u32[3].u32 ^
+                 ((uint32_t)pfx_len << 8) ^ (uint32_t)metric_type;
 
-    null_time = timex_set(0, 0);
-    max_seqnum_lifetime = timex_set(CONFIG_AODVV2_MAX_SEQNUM_LIFETIME, 0);
-    active_interval = timex_set(CONFIG_AODVV2_ACTIVE_INTERVAL, 0);
-    max_idletime = timex_set(CONFIG_AODVV2_MAX_IDLETIME, 0);
-    validity_t = timex_set(CONFIG_AODVV2_ACTIVE_INTERVAL +
-                           CONFIG_AODVV2_MAX_IDLETIME, 0);
+    /* Mix the bits so the bucket doesn't depend only on the low bits of
+     * the interface identifier */
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
 
-    memset(&routing_table, 0, sizeof(routing_table));
+    return h % CONFIG_AODVV2_LRS_HASH_BUCKETS;
 }
 
-ipv6_addr_t *aodvv2_lrs_get_next_hop(ipv6_addr_t *dest,
-                                     routing_metric_t metric_type)
+static uint32_t _used_bit(const ipv6_addr_t *addr)
 {
-    aodvv2_local_route_t *entry = aodvv2_lrs_get_entry(dest, metric_type);
-    if (!entry) {
-        return NULL;
+    uint32_t h = addr->u32[2].u32 ^ addr->u32[3].u32;
+
+    h ^= h >> 16;
+    h ^= h >> 8;
+
+    return UINT32_C(1) << (h & 31);
+}
+
+/*
+ * Compare two tick counts, taking care of the wrap around
+ */
+static inline bool _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static inline bool _is_valid(uint8_t state)
+{
+    return (state == ROUTE_STATE_ACTIVE) || (state == ROUTE_STATE_IDLE);
+}
+
+/*
+ * Queue entry i for the next NIB sync, updates of the same route until then
+ * result in a single NIB operation
+ */
+static void _nib_mark(lrs_idx_t i)
+{
+    if (_data[i].flags & LRS_FLAG_NIB_PENDING) {
+        return;
+    }
+
+    _data[i].flags |= LRS_FLAG_NIB_PENDING;
+    _nib_pending[_nib_pending_num++] = i;
+}
+
+static void _nib_unmark(lrs_idx_t i)
+{
+    if (!(_data[i].flags & LRS_FLAG_NIB_PENDING)) {
+        return;
+    }
+
+    for (unsigned pos = 0; pos < _nib_pending_num; pos++) {
+        if (_nib_pending[pos] == i) {
+            _nib_pending[pos] = _nib_pending[--_nib_pending_num];
+            break;
+        }
+    }
+    _data[i].flags &= ~LRS_FLAG_NIB_PENDING;
+}
+
+static void _pfx_len_ref(lrs_idx_t i)
+{
+    uint8_t pfx_len = _keys[i].pfx_len;
+    unsigned pos;
+
+    for (pos = 0; pos < _pfx_lens_num; pos++) {
+        if (_pfx_lens[pos].pfx_len == pfx_len) {
+            _pfx_lens[pos].refs++;
+            _data[i].flags |= LRS_FLAG_PFX_INDEXED;
+            return;
+        }
+        if (_pfx_lens[pos].pfx_len < pfx_len) {
+            break;
+        }
     }
-    return (&entry->next_hop);
+
+    if (_pfx_lens_num == ARRAY_SIZE(_pfx_lens)) {
+        DEBUG("aodvv2: prefix length table is full, /%u is scanned for\n",
+              pfx_len);
+        _pfx_unindexed++;
+        return;
+    }
+
+    /* Insert keeping the table sorted, longest first */
+    memmove(&_pfx_lens[pos + 1], &_pfx_lens[pos],
+            (_pfx_lens_num - pos) * sizeof(lrs_pfx_len_t));
+    _pfx_lens[pos].pfx_len = pfx_len;
+    _pfx_lens[pos].refs = 1;
+    _pfx_lens_num++;
+
+    _data[i].flags |= LRS_FLAG_PFX_INDEXED;
 }
 
-void aodvv2_lrs_add_entry(aodvv2_local_route_t *entry)
+static void _pfx_len_unref(lrs_idx_t i)
 {
-    /* only add if we don't already know the address */
-    if (aodvv2_lrs_get_entry(&entry->addr, entry->metric_type)) {
+    uint8_t pfx_len = _keys[i].pfx_len;
+
+    if (!(_data[i].flags & LRS_FLAG_PFX_INDEXED)) {
+        _pfx_unindexed--;
         return;
     }
-    /*find free spot in RT and place rt_entry there */
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        if (!routing_table[i].used) {
-            memcpy(&routing_table[i].route, entry, sizeof(aodvv2_local_route_t));
-            routing_table[i].used = true;
+    _data[i].flags &= ~LRS_FLAG_PFX_INDEXED;
+
+    for (unsigned pos = 0; pos < _pfx_lens_num; pos++) {
+        if (_pfx_lens[pos].pfx_len == pfx_len) {
+            if (--_pfx_lens[pos].refs == 0) {
+                _pfx_lens_num--;
+                memmove(&_pfx_lens[pos], &_pfx_lens[pos + 1],
+                        (_pfx_lens_num - pos) * sizeof(lrs_pfx_len_t));
+            }
             return;
         }
     }
 }
 
-aodvv2_local_route_t *aodvv2_lrs_get_entry(ipv6_addr_t *addr,
-                                           routing_metric_t metric_type)
+static void _heap_swap(unsigned a, unsigned b)
+{
+    lrs_idx_t tmp = _heap[a];
+    _heap[a] = _heap[b];
+    _heap[b] = tmp;
+
+    _data[_heap[a]].heap_pos = a;
+    _data[_heap[b]].heap_pos = b;
+}
+
+/*
+ * Time of the next state transition of entry i as described in Section 6.3.
+ * It's computed from the route rather than stored, so anything it depends on
+ * may only change right before a call to _schedule().
+ */
+static uint32_t _deadline(lrs_idx_t i)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        _reset_entry_if_stale(i);
+    const lrs_data_t *data = &_data[i];
+
+    switch (_keys[i].state) {
+        /* An Active route is considered to remain Active as long as it is
+         * used at least once during every ACTIVE_INTERVAL. */
+        case ROUTE_STATE_ACTIVE:
+            return data->last_used + active_interval;
 
-        if (ipv6_addr_equal(&routing_table[i].route.addr, addr) &&
-            routing_table[i].route.metric_type == metric_type) {
-            return &routing_table[i].route;
+        /* An Idle route becomes Expired at Route.ExpirationTime */
+        case ROUTE_STATE_IDLE:
+        case ROUTE_STATE_TIMED:
+            return data->expiration_time;
+
+        /* After MAX_SEQNUM_LIFETIME the Expired route MUST be expunged */
+        default:
+            return data->last_used + max_seqnum_lifetime;
+    }
+}
+
+static inline uint32_t _heap_key(unsigned pos)
+{
+    return _deadline(_heap[pos]);
+}
+
+static void _heap_up(unsigned pos)
+{
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if (!_before(_heap_key(pos), _heap_key(parent))) {
+            break;
         }
+        _heap_swap(parent, pos);
+        pos = parent;
+    }
+}
+
+static void _heap_down(unsigned pos)
+{
+    while (1) {
+        unsigned smallest = pos;
+        unsigned left = (2 * pos) + 1;
+        unsigned right = left + 1;
+
+        if (left < _heap_len && _before(_heap_key(left), _heap_key(smallest))) {
+            smallest = left;
+        }
+        if (right < _heap_len && _before(_heap_key(right), _heap_key(smallest))) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        _heap_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void _heap_remove(lrs_idx_t i)
+{
+    unsigned pos = _data[i].heap_pos;
+
+    _heap_len--;
+    if (pos != _heap_len) {
+        _heap_swap(pos, _heap_len);
+        _heap_up(pos);
+        _heap_down(pos);
     }
-    return NULL;
+    _data[i].heap_pos = LRS_IDX_NONE;
 }
 
-void aodvv2_lrs_delete_entry(ipv6_addr_t *addr, routing_metric_t metric_type)
+/*
+ * Arm the timer for the earliest deadline on the queue
+ */
+static void _timer_update(void)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        _reset_entry_if_stale(i);
+    if (_heap_len == 0 || _timer_pid == KERNEL_PID_UNDEF) {
+        xtimer_remove(&_timer);
+        return;
+    }
 
-        if (routing_table[i].used) {
-            if (ipv6_addr_equal(&routing_table[i].route.addr, addr) &&
-                routing_table[i].route.metric_type == metric_type) {
-                memset(&routing_table[i].route, 0, sizeof(aodvv2_local_route_t));
-                routing_table[i].used = false;
-                return;
+    uint32_t now = aodvv2_lrs_now();
+    uint32_t deadline = _heap_key(0);
+    uint64_t offset = 0;
+
+    if (_before(now, deadline)) {
+        offset = (uint64_t)(deadline - now) * US_PER_MS;
+    }
+
+    _timer_msg.type = AODVV2_MSG_TYPE_LRS_TIMEOUT;
+    xtimer_set_msg64(&_timer, offset, &_timer_msg, _timer_pid);
+}
+
+/*
+ * (Re)schedule entry i on the deadline queue after its deadline changed
+ */
+static void _schedule(lrs_idx_t i)
+{
+    lrs_data_t *data = &_data[i];
+    lrs_idx_t root = (_heap_len > 0) ? _heap[0] : LRS_IDX_NONE;
+
+    if (data->heap_pos == LRS_IDX_NONE) {
+        data->heap_pos = _heap_len;
+        _heap[_heap_len++] = i;
+    }
+    _heap_up(data->heap_pos);
+    _heap_down(data->heap_pos);
+
+    /* Only touch the timer if the earliest deadline changed */
+    if (_heap[0] != root || root == i) {
+        _timer_update();
+    }
+}
+
+/*
+ * Routes are keyed by their prefix with all host bits cleared, so a route is
+ * found the same way no matter which of its addresses it was learned from.
+ */
+static void _key_addr(ipv6_addr_t *key, const ipv6_addr_t *addr,
+                      uint8_t pfx_len)
+{
+    *key = ipv6_addr_unspecified;
+    ipv6_addr_init_prefix(key, addr, pfx_len);
+}
+
+/*
+ * Find the entry for (addr, pfx_len, metric_type), if found `prev` is set to
+ * the entry preceding it on the bucket chain (LRS_IDX_NONE if it's the head).
+ * Nested prefixes share their address, so the prefix length is part of the
+ * key.
+ */
+static lrs_idx_t _find(const ipv6_addr_t *addr, uint8_t pfx_len,
+                       routing_metric_t metric_type, lrs_idx_t *prev)
+{
+    lrs_idx_t p = LRS_IDX_NONE;
+    lrs_idx_t i = _buckets[_hash(addr, pfx_len, metric_type)];
+
+    while (i != LRS_IDX_NONE) {
+        lrs_key_t *key = &_keys[i];
+
+        if (key->pfx_len == pfx_len && key->metric_type == metric_type &&
+            ipv6_addr_equal(&key->addr, addr)) {
+            if (prev) {
+                *prev = p;
             }
+            return i;
+        }
+
+        p = i;
+        i = key->next;
+    }
+
+    return LRS_IDX_NONE;
+}
+
+/*
+ * Longest prefix match over the valid routes, probing the hash index once for
+ * every prefix length in use
+ */
+static lrs_idx_t _lookup(const ipv6_addr_t *addr, routing_metric_t metric_type)
+{
+    lrs_idx_t best = LRS_IDX_NONE;
+
+    for (unsigned pos = 0; pos < _pfx_lens_num; pos++) {
+        uint8_t pfx_len = _pfx_lens[pos].pfx_len;
+        ipv6_addr_t pfx;
+        _key_addr(&pfx, addr, pfx_len);
+
+        lrs_idx_t i = _find(&pfx, pfx_len, metric_type, NULL);
+        if (i != LRS_IDX_NONE && _is_valid(_keys[i].state)) {
+            best = i;
+            break;
+        }
+    }
+
+    if (_pfx_unindexed == 0) {
+        return best;
+    }
+
+    /* The routes whose prefix length isn't on the table can only be found
+     * by walking all of them */
+    for (unsigned i = 0; i < _capacity; i++) {
+        const lrs_key_t *key = &_keys[i];
+
+        if ((_data[i].flags & LRS_FLAG_PFX_INDEXED) ||
+            !_is_valid(key->state) || key->metric_type != metric_type ||
+            ipv6_addr_match_prefix(addr, &key->addr) < key->pfx_len) {
+            continue;
+        }
+        if (best == LRS_IDX_NONE || key->pfx_len > _keys[best].pfx_len) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+/*
+ * Unlink entry i from its bucket and the deadline queue, and place it on the
+ * free list
+ */
+static void _remove(lrs_idx_t i, lrs_idx_t prev)
+{
+    lrs_key_t *key = &_keys[i];
+
+    if (prev == LRS_IDX_NONE) {
+        _buckets[_hash(&key->addr, key->pfx_len, key->metric_type)] =
+            key->next;
+    }
+    else {
+        _keys[prev].next = key->next;
+    }
+
+    _pfx_len_unref(i);
+    _nib_unmark(i);
+
+    if (_data[i].flags & LRS_FLAG_NIB_INSTALLED) {
+        gnrc_ipv6_nib_ft_del(&key->addr, key->pfx_len);
+    }
+
+    if (_data[i].heap_pos != LRS_IDX_NONE) {
+        bool was_root = (_data[i].heap_pos == 0);
+        _heap_remove(i);
+        if (was_root) {
+            _timer_update();
+        }
+    }
+
+    memset(&key->addr, 0, sizeof(key->addr));
+    key->state = LRS_STATE_UNUSED;
+    key->next = _free_head;
+    _free_head = i;
+
+    memset(&_data[i], 0, sizeof(lrs_data_t));
+    _data[i].heap_pos = LRS_IDX_NONE;
+}
+
+/*
+ * Copy entry i into the public representation of a route
+ */
+static void _load(lrs_idx_t i, aodvv2_local_route_t *route)
+{
+    const lrs_key_t *key = &_keys[i];
+    const lrs_data_t *data = &_data[i];
+
+    route->addr = key->addr;
+    route->pfx_len = key->pfx_len;
+    route->seqnum = data->seqnum;
+    route->next_hop = data->next_hop;
+    route->last_used = data->last_used;
+    route->expiration_time = data->expiration_time;
+    route->metric_type = key->metric_type;
+    route->metric = data->metric;
+    route->state = key->state;
+}
+
+/*
+ * Store the route on entry i, which must already be indexed by the route's
+ * (address, prefix length, metric type), and update the rest of the indexes.
+ */
+static void _store(lrs_idx_t i, const aodvv2_local_route_t *route)
+{
+    lrs_data_t *data = &_data[i];
+
+    bool moved = !ipv6_addr_equal(&data->next_hop, &route->next_hop);
+    bool changed = moved || (_keys[i].state != route->state) ||
+                   (data->expiration_time != route->expiration_time);
+
+    /* The NIB can't change the next hop of a route in place, the old one
+     * has to be removed first */
+    if ((data->flags & LRS_FLAG_NIB_INSTALLED) && moved) {
+        data->flags |= LRS_FLAG_NIB_STALE;
+    }
+    if (changed || !(data->flags & LRS_FLAG_NIB_INSTALLED)) {
+        _nib_mark(i);
+    }
+
+    /* Alternates are only loop-free for the SeqNum they were learned with */
+    if (data->seqnum != route->seqnum) {
+        data->alts_num = 0;
+    }
+
+    _keys[i].state = route->state;
+
+    data->seqnum = route->seqnum;
+    data->next_hop = route->next_hop;
+    data->last_used = route->last_used;
+    data->expiration_time = route->expiration_time;
+    data->metric = route->metric;
+
+    /* The route has new data, it can be refreshed again */
+    data->flags &= ~LRS_FLAG_REFRESH_SENT;
+
+    _schedule(i);
+}
+
+static void _alt_del(lrs_data_t *data, unsigned pos)
+{
+    unsigned num = --data->alts_num - pos;
+
+    memmove(&data->alt_hops[pos], &data->alt_hops[pos + 1],
+            num * sizeof(ipv6_addr_t));
+    memmove(&data->alt_adv_metrics[pos], &data->alt_adv_metrics[pos + 1], num);
+    memmove(&data->alt_metrics[pos], &data->alt_metrics[pos + 1], num);
+}
+
+/*
+ * Drop the alternates that are no longer usable after the primary route of
+ * entry i changed
+ */
+static void _alts_revalidate(lrs_idx_t i)
+{
+    lrs_data_t *data = &_data[i];
+
+    for (unsigned pos = 0; pos < data->alts_num;) {
+        if (ipv6_addr_equal(&data->alt_hops[pos], &data->next_hop) ||
+            data->alt_adv_metrics[pos] >= data->metric) {
+            _alt_del(data, pos);
+            continue;
+        }
+        pos++;
+    }
+}
+
+/*
+ * Entry i reached its deadline, move it to the next state
+ */
+static void _expire(lrs_idx_t i, uint32_t now)
+{
+    switch (_keys[i].state) {
+        /* When a route is no longer Active, it becomes an Idle route. It's
+         * taken off the NIB, so the next packet through it is reported by
+         * the route info callback and makes it Active again. */
+        case ROUTE_STATE_ACTIVE:
+            _keys[i].state = ROUTE_STATE_IDLE;
+            _data[i].last_used = now; /* mark the time entry was set to Idle */
+            _schedule(i);
+            _nib_mark(i);
+            break;
+
+        /* After an idle route remains Idle for MAX_IDLETIME, it becomes an
+         * Expired route. */
+        case ROUTE_STATE_IDLE:
+        case ROUTE_STATE_TIMED:
+            DEBUG("aodvv2: route expired, now: %" PRIu32 "\n", now);
+            _keys[i].state = ROUTE_STATE_EXPIRED;
+            _data[i].last_used = now; /* mark the time entry was set to Expired */
+            _schedule(i);
+            _nib_mark(i);
+            break;
+
+        /* After that time, old sequence number information is considered no
+         * longer valuable and the Expired route MUST BE expunged */
+        default: {
+            lrs_idx_t prev;
+            _find(&_keys[i].addr, _keys[i].pfx_len, _keys[i].metric_type,
+                  &prev);
+            _remove(i, prev);
+            break;
         }
     }
 }
 
+size_t aodvv2_lrs_entry_size(void)
+{
+    return sizeof(lrs_key_t) + sizeof(lrs_data_t) + (2 * sizeof(lrs_idx_t));
+}
+
+int aodvv2_lrs_set_pool(void *pool, size_t size)
+{
+    assert(pool != NULL);
+
+    /* The routes are already stored on the current pool */
+    if (_keys != NULL) {
+        DEBUG_PUTS("aodvv2: Local Route Set already initialized");
+        return -EBUSY;
+    }
+
+    if (size < aodvv2_lrs_entry_size() + _Alignof(lrs_data_t)) {
+        return -ENOMEM;
+    }
+
+    _pool = pool;
+    _pool_size = size;
+    return 0;
+}
+
+void aodvv2_lrs_init(kernel_pid_t pid, kernel_pid_t netif_pid)
+{
+    DEBUG("aodvv2_lrs_init()\n");
+
+    max_seqnum_lifetime = CONFIG_AODVV2_MAX_SEQNUM_LIFETIME * MS_PER_SEC;
+    active_interval = CONFIG_AODVV2_ACTIVE_INTERVAL * MS_PER_SEC;
+    validity_t = (CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME) *
+                 MS_PER_SEC;
+    refresh_time = CONFIG_AODVV2_LRS_REFRESH_TIME * MS_PER_SEC;
+
+    xtimer_remove(&_timer);
+    _timer_pid = pid;
+    _netif_pid = netif_pid;
+
+    /* Carve the arrays out of the pool */
+    uintptr_t base = ((uintptr_t)_pool + _Alignof(lrs_data_t) - 1) &
+                     ~(uintptr_t)(_Alignof(lrs_data_t) - 1);
+    size_t size = _pool_size - (base - (uintptr_t)_pool);
+
+    _capacity = size / aodvv2_lrs_entry_size();
+    if (_capacity >= LRS_IDX_NONE) {
+        _capacity = LRS_IDX_NONE - 1;
+    }
+    DEBUG("aodvv2: %u routing entries\n", _capacity);
+
+    _keys = (lrs_key_t *)base;
+    _data = (lrs_data_t *)&_keys[_capacity];
+    _heap = (lrs_idx_t *)&_data[_capacity];
+    _nib_pending = &_heap[_capacity];
+
+    memset(_keys, 0, _capacity * sizeof(lrs_key_t));
+    memset(_data, 0, _capacity * sizeof(lrs_data_t));
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_buckets); i++) {
+        _buckets[i] = LRS_IDX_NONE;
+    }
+
+    /* All entries start on the free list */
+    for (unsigned i = 0; i < _capacity; i++) {
+        _keys[i].state = LRS_STATE_UNUSED;
+        _keys[i].next = (i + 1 < _capacity)
+                      ? (lrs_idx_t)(i + 1) : LRS_IDX_NONE;
+        _data[i].heap_pos = LRS_IDX_NONE;
+    }
+    _free_head = (_capacity > 0) ? 0 : LRS_IDX_NONE;
+    _heap_len = 0;
+    _pfx_lens_num = 0;
+    _pfx_unindexed = 0;
+    _nib_pending_num = 0;
+
+    atomic_store(&_used_head, 0);
+    atomic_store(&_used_tail, 0);
+    atomic_store(&_used_filter, 0);
+}
 
 /*
- * Check if entry at index i is stale as described in Section 6.3.
- * and clear the struct it fills if it is
+ * Whether the route of entry i has to be refreshed now that it was used
  */
-static void _reset_entry_if_stale(uint8_t i)
+static bool _refresh_due(lrs_idx_t i, uint32_t now)
 {
-    xtimer_now_timex(&now);
-    timex_t last_used, expiration_time;
+    const lrs_data_t *data = &_data[i];
 
-    if (timex_cmp(routing_table[i].route.expiration_time, null_time) == 0) {
+    if (refresh_time == 0 ||
+        (data->flags & (LRS_FLAG_REFRESH | LRS_FLAG_REFRESH_SENT)) !=
+        LRS_FLAG_REFRESH) {
+        return false;
+    }
+
+    return !_before(now, data->expiration_time - refresh_time);
+}
+
+/*
+ * Update the routes used since the last run with the packets queued by
+ * aodvv2_lrs_mark_used(), and refresh the ones about to expire
+ */
+static void _collect_used(uint32_t now, aodvv2_lrs_refresh_cb_t refresh_cb,
+                          aodvv2_lrs_used_cb_t used_cb)
+{
+    atomic_store_explicit(&_used_filter, 0, memory_order_relaxed);
+
+    unsigned tail = atomic_load_explicit(&_used_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&_used_head, memory_order_acquire);
+
+    while (tail != head) {
+        lrs_used_t used = _used[tail % ARRAY_SIZE(_used)];
+        atomic_store_explicit(&_used_tail, ++tail, memory_order_release);
+
+        aodvv2_local_route_t route;
+        lrs_idx_t i = _lookup(&used.dst, CONFIG_AODVV2_DEFAULT_METRIC);
+        if (i == LRS_IDX_NONE) {
+            if (used_cb) {
+                used_cb(NULL, &used.src, &used.dst);
+            }
+            continue;
+        }
+
+        /* An Idle route becomes Active again when it's used, and goes back
+         * on the NIB */
+        _keys[i].state = ROUTE_STATE_ACTIVE;
+        _data[i].last_used = now;
+        _schedule(i);
+        if (!(_data[i].flags & LRS_FLAG_NIB_INSTALLED)) {
+            _nib_mark(i);
+        }
+
+        _load(i, &route);
+        if (_refresh_due(i, now)) {
+            DEBUG_PUTS("aodvv2: refreshing route");
+            _data[i].flags |= LRS_FLAG_REFRESH_SENT;
+            if (refresh_cb) {
+                refresh_cb(&route, &used.src);
+            }
+        }
+        if (used_cb) {
+            used_cb(&route, &used.src, &used.dst);
+        }
+    }
+}
+
+void aodvv2_lrs_mark_used(const ipv6_addr_t *src, const ipv6_addr_t *dst)
+{
+    assert(src != NULL && dst != NULL);
+
+    uint32_t bit = _used_bit(dst);
+    if (atomic_load_explicit(&_used_filter, memory_order_relaxed) & bit) {
+        return;
+    }
+
+    unsigned head = atomic_load_explicit(&_used_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&_used_tail, memory_order_acquire);
+    if (head - tail >= ARRAY_SIZE(_used)) {
         return;
     }
 
-    int state = routing_table[i].route.state;
-    last_used = routing_table[i].route.last_used;
-    expiration_time = routing_table[i].route.expiration_time;
+    _used[head % ARRAY_SIZE(_used)].src = *src;
+    _used[head % ARRAY_SIZE(_used)].dst = *dst;
+    atomic_store_explicit(&_used_head, head + 1, memory_order_release);
+    atomic_fetch_or_explicit(&_used_filter, bit, memory_order_relaxed);
+}
+
+void aodvv2_lrs_timeout(aodvv2_lrs_refresh_cb_t refresh_cb,
+                        aodvv2_lrs_used_cb_t used_cb)
+{
+    uint32_t now = aodvv2_lrs_now();
+
+    _collect_used(now, refresh_cb, used_cb);
+
+    while (_heap_len > 0 && !_before(now, _heap_key(0))) {
+        _expire(_heap[0], now);
+    }
+
+    _timer_update();
+}
+
+ipv6_addr_t *aodvv2_lrs_get_next_hop(ipv6_addr_t *dest,
+                                     routing_metric_t metric_type)
+{
+    lrs_idx_t i = _lookup(dest, metric_type);
+    if (i == LRS_IDX_NONE) {
+        return NULL;
+    }
+    return &_data[i].next_hop;
+}
+
+/*
+ * Make room for a new route, removing the Expired or Broken route that has
+ * been so for the longest time, or otherwise the least recently used Idle
+ * one. Active routes are never evicted.
+ */
+static bool _evict(void)
+{
+    lrs_idx_t victim = LRS_IDX_NONE;
+    unsigned victim_rank = 0;
+
+    for (unsigned i = 0; i < _capacity; i++) {
+        unsigned rank;
+
+        switch (_keys[i].state) {
+            case ROUTE_STATE_EXPIRED:
+            case ROUTE_STATE_BROKEN:
+                rank = 2;
+                break;
+            case ROUTE_STATE_IDLE:
+            case ROUTE_STATE_TIMED:
+                rank = 1;
+                break;
+            default:
+                continue;
+        }
+
+        if (victim == LRS_IDX_NONE || rank > victim_rank ||
+            (rank == victim_rank &&
+             _before(_data[i].last_used, _data[victim].last_used))) {
+            victim = i;
+            victim_rank = rank;
+        }
+    }
+
+    if (victim == LRS_IDX_NONE) {
+        return false;
+    }
+
+    DEBUG("aodvv2: evicting route in state %u\n", _keys[victim].state);
+    lrs_idx_t prev;
+    _find(&_keys[victim].addr, _keys[victim].pfx_len,
+          _keys[victim].metric_type, &prev);
+    _remove(victim, prev);
+    return true;
+}
+
+bool aodvv2_lrs_add_entry(const aodvv2_local_route_t *entry)
+{
+    ipv6_addr_t addr;
+    _key_addr(&addr, &entry->addr, entry->pfx_len);
 
-    /* an Active route is considered to remain Active as long as it is used at least once
-     * during every ACTIVE_INTERVAL. When a route is no longer Active, it becomes an Idle route. */
+    /* only add if we don't already know the prefix */
+    if (_find(&addr, entry->pfx_len, entry->metric_type, NULL) !=
+        LRS_IDX_NONE) {
+        return false;
+    }
 
-    /* if the node is younger than the active interval, don't bother */
-    if (timex_cmp(now, active_interval) < 0) {
+    /* take a free spot in RT and place rt_entry there */
+    if (_free_head == LRS_IDX_NONE && !_evict()) {
+        DEBUG_PUTS("aodvv2: routing table is full of active routes");
+        return false;
+    }
+    lrs_idx_t i = _free_head;
+    _free_head = _keys[i].next;
+
+    unsigned bucket = _hash(&addr, entry->pfx_len, entry->metric_type);
+    _keys[i].addr = addr;
+    _keys[i].pfx_len = entry->pfx_len;
+    _keys[i].metric_type = entry->metric_type;
+    _keys[i].next = _buckets[bucket];
+    _buckets[bucket] = i;
+    _pfx_len_ref(i);
+
+    _store(i, entry);
+    return true;
+}
+
+void aodvv2_lrs_update_entry(const aodvv2_local_route_t *entry)
+{
+    ipv6_addr_t addr;
+    _key_addr(&addr, &entry->addr, entry->pfx_len);
+
+    lrs_idx_t i = _find(&addr, entry->pfx_len, entry->metric_type, NULL);
+    if (i == LRS_IDX_NONE) {
+        aodvv2_lrs_add_entry(entry);
         return;
     }
 
-    if ((state == ROUTE_STATE_ACTIVE) &&
-        (timex_cmp(timex_sub(now, active_interval), last_used) == 1)) {
-        routing_table[i].route.state = ROUTE_STATE_IDLE;
-        routing_table[i].route.last_used = now; /* mark the time entry was set to Idle */
+    _store(i, entry);
+    _alts_revalidate(i);
+}
+
+void aodvv2_lrs_set_refresh(const ipv6_addr_t *addr, uint8_t pfx_len,
+                            routing_metric_t metric_type)
+{
+    if (refresh_time == 0) {
+        return;
     }
 
-    /* After an idle route remains Idle for MAX_IDLETIME, it becomes an Expired route.
-       A route MUST be considered Expired if Current_Time >= Route.ExpirationTime
-    */
+    ipv6_addr_t key;
+    _key_addr(&key, addr, pfx_len);
 
-    /* if the node is younger than the expiration time, don't bother */
-    if (timex_cmp(now, expiration_time) < 0) {
+    lrs_idx_t i = _find(&key, pfx_len, metric_type, NULL);
+    if (i == LRS_IDX_NONE || (_data[i].flags & LRS_FLAG_REFRESH)) {
         return;
     }
 
-    if ((state == ROUTE_STATE_IDLE) &&
-        (timex_cmp(expiration_time, now) < 1)) {
-        DEBUG("\t expiration_time: %"PRIu32":%"PRIu32" , now: %"PRIu32":%"PRIu32"\n",
-              expiration_time.seconds, expiration_time.microseconds,
-              now.seconds, now.microseconds);
-        routing_table[i].route.state = ROUTE_STATE_EXPIRED;
-        routing_table[i].route.last_used = now; /* mark the time entry was set to Expired */
+    _data[i].flags |= LRS_FLAG_REFRESH;
+    _schedule(i);
+}
+
+bool aodvv2_lrs_get_entry(const ipv6_addr_t *addr, uint8_t pfx_len,
+                          routing_metric_t metric_type,
+                          aodvv2_local_route_t *route)
+{
+    ipv6_addr_t key;
+    _key_addr(&key, addr, pfx_len);
+
+    lrs_idx_t i = _find(&key, pfx_len, metric_type, NULL);
+    if (i == LRS_IDX_NONE) {
+        return false;
+    }
+
+    if (route) {
+        _load(i, route);
+    }
+    return true;
+}
+
+bool aodvv2_lrs_lookup(const ipv6_addr_t *addr, routing_metric_t metric_type,
+                       aodvv2_local_route_t *route)
+{
+    lrs_idx_t i = _lookup(addr, metric_type);
+    if (i == LRS_IDX_NONE) {
+        return false;
+    }
+
+    if (route) {
+        _load(i, route);
     }
+    return true;
+}
+
+void aodvv2_lrs_delete_entry(const ipv6_addr_t *addr, uint8_t pfx_len,
+                             routing_metric_t metric_type)
+{
+    ipv6_addr_t key;
+    _key_addr(&key, addr, pfx_len);
 
-    /* After that time, old sequence number information is considered no longer
-     * valuable and the Expired route MUST BE expunged */
-    if (timex_cmp(timex_sub(now, last_used), max_seqnum_lifetime) >= 0) {
-        memset(&routing_table[i].route, 0, sizeof(aodvv2_local_route_t));
+    lrs_idx_t prev;
+    lrs_idx_t i = _find(&key, pfx_len, metric_type, &prev);
+    if (i != LRS_IDX_NONE) {
+        _remove(i, prev);
     }
 }
 
-bool aodvv2_lrs_offers_improvement(aodvv2_local_route_t *rt_entry,
+bool aodvv2_lrs_offers_improvement(const aodvv2_local_route_t *rt_entry,
                                    node_data_t *node_data)
 {
+    int16_t seqcmp = aodvv2_seqnum_cmp(rt_entry->seqnum, node_data->seqnum);
+
     /* Check if new info is stale */
-    if (aodvv2_seqnum_cmp(node_data->seqnum, rt_entry->seqnum) < 0) {
+    if (seqcmp < 0) {
         return false;
     }
-    /* Check if new info is more costly */
-    if ((node_data->metric >= rt_entry->metric)
-        && !(rt_entry->state != ROUTE_STATE_BROKEN)) {
+
+    /* Check if new info is more costly, unless it repairs a broken route */
+    if ((seqcmp == 0) && (node_data->metric >= rt_entry->metric) &&
+        (rt_entry->state != ROUTE_STATE_BROKEN)) {
         return false;
     }
-    /* Check if new info repairs a broken route */
-    if (!(rt_entry->state != ROUTE_STATE_BROKEN)) {
+
+    return true;
+}
+
+bool aodvv2_lrs_add_alternate(const aodvv2_local_route_t *rt_entry,
+                              node_data_t *node_data,
+                              const ipv6_addr_t *next_hop, uint8_t link_cost)
+{
+    assert(rt_entry != NULL && node_data != NULL && next_hop != NULL);
+
+    ipv6_addr_t addr;
+    _key_addr(&addr, &rt_entry->addr, rt_entry->pfx_len);
+
+    lrs_idx_t i = _find(&addr, rt_entry->pfx_len, rt_entry->metric_type, NULL);
+    if (i == LRS_IDX_NONE || !_is_valid(_keys[i].state)) {
+        return false;
+    }
+
+    lrs_data_t *data = &_data[i];
+
+    /* Only information as fresh as the primary route can be used */
+    if (aodvv2_seqnum_cmp(data->seqnum, node_data->seqnum) != 0 ||
+        ipv6_addr_equal(&data->next_hop, next_hop)) {
         return false;
     }
+
+    /* The next hop must be strictly closer to the destination than we are,
+     * otherwise it could be routing through us */
+    if (node_data->metric < link_cost) {
+        return false;
+    }
+    uint8_t adv_metric = node_data->metric - link_cost;
+    if (adv_metric >= data->metric) {
+        return false;
+    }
+
+    /* Replace a previous alternate through the same next hop */
+    for (unsigned pos = 0; pos < data->alts_num; pos++) {
+        if (ipv6_addr_equal(&data->alt_hops[pos], next_hop)) {
+            _alt_del(data, pos);
+            break;
+        }
+    }
+
+    /* Find its place, keeping the list sorted by metric */
+    unsigned pos;
+    for (pos = 0; pos < data->alts_num; pos++) {
+        if (node_data->metric < data->alt_metrics[pos]) {
+            break;
+        }
+    }
+
+    if (pos == ARRAY_SIZE(data->alt_hops)) {
+        return false;
+    }
+
+    if (data->alts_num == ARRAY_SIZE(data->alt_hops)) {
+        /* Drop the worst one */
+        data->alts_num--;
+    }
+
+    unsigned num = data->alts_num - pos;
+    memmove(&data->alt_hops[pos + 1], &data->alt_hops[pos],
+            num * sizeof(ipv6_addr_t));
+    memmove(&data->alt_adv_metrics[pos + 1], &data->alt_adv_metrics[pos], num);
+    memmove(&data->alt_metrics[pos + 1], &data->alt_metrics[pos], num);
+    data->alt_hops[pos] = *next_hop;
+    data->alt_adv_metrics[pos] = adv_metric;
+    data->alt_metrics[pos] = node_data->metric;
+    data->alts_num++;
+
+    DEBUG("aodvv2: %u alternates for route\n", data->alts_num);
     return true;
 }
 
+void aodvv2_lrs_link_broken(const ipv6_addr_t *next_hop,
+                            aodvv2_lrs_route_cb_t cb)
+{
+    assert(next_hop != NULL);
+
+    uint32_t now = aodvv2_lrs_now();
+
+    for (unsigned i = 0; i < _capacity; i++) {
+        lrs_key_t *key = &_keys[i];
+        lrs_data_t *data = &_data[i];
+
+        if (key->state == LRS_STATE_UNUSED ||
+            key->state == ROUTE_STATE_BROKEN) {
+            continue;
+        }
+
+        for (unsigned pos = 0; pos < data->alts_num;) {
+            if (ipv6_addr_equal(&data->alt_hops[pos], next_hop)) {
+                _alt_del(data, pos);
+                continue;
+            }
+            pos++;
+        }
+
+        if (!ipv6_addr_equal(&data->next_hop, next_hop)) {
+            continue;
+        }
+
+        if (data->alts_num > 0 && _is_valid(key->state)) {
+            DEBUG_PUTS("aodvv2: failing over to alternate next hop");
+            data->next_hop = data->alt_hops[0];
+            data->metric = data->alt_metrics[0];
+            _alt_del(data, 0);
+            if (data->flags & LRS_FLAG_NIB_INSTALLED) {
+                data->flags |= LRS_FLAG_NIB_STALE;
+            }
+        }
+        else {
+            DEBUG_PUTS("aodvv2: route is broken");
+            key->state = ROUTE_STATE_BROKEN;
+            data->last_used = now; /* mark the time entry was set to Broken */
+            _schedule(i);
+        }
+        _nib_mark(i);
+
+        if (cb) {
+            aodvv2_local_route_t route;
+            _load(i, &route);
+            cb(&route);
+        }
+    }
+}
+
+void aodvv2_lrs_nib_sync(void)
+{
+    for (unsigned pos = 0; pos < _nib_pending_num; pos++) {
+        lrs_idx_t i = _nib_pending[pos];
+        lrs_key_t *key = &_keys[i];
+        lrs_data_t *data = &_data[i];
+        /* Only Active routes are installed, traffic through an Idle one
+         * has to go through the route info callback to be noticed */
+        bool valid = (key->state == ROUTE_STATE_ACTIVE);
+
+        if ((data->flags & LRS_FLAG_NIB_INSTALLED) &&
+            ((data->flags & LRS_FLAG_NIB_STALE) || !valid)) {
+            gnrc_ipv6_nib_ft_del(&key->addr, key->pfx_len);
+            data->flags &= ~LRS_FLAG_NIB_INSTALLED;
+        }
+        data->flags &= ~(LRS_FLAG_NIB_PENDING | LRS_FLAG_NIB_STALE);
+
+        if (!valid) {
+            continue;
+        }
+
+        /* An Active route stays valid past its expiration time as long as
+         * it's used, so the NIB must not expire it on its own. Routes are
+         * installed without a lifetime and removed by the LRS when they
+         * stop being valid. */
+        if (gnrc_ipv6_nib_ft_add(&key->addr, key->pfx_len, &data->next_hop,
+                                 _netif_pid, 0) < 0) {
+            DEBUG_PUTS("aodvv2: couldn't add route");
+            continue;
+        }
+        data->flags |= LRS_FLAG_NIB_INSTALLED;
+    }
+
+    _nib_pending_num = 0;
+}
+
+bool aodvv2_lrs_nib_installed(const aodvv2_local_route_t *route)
+{
+    assert(route != NULL);
+
+    ipv6_addr_t addr;
+    _key_addr(&addr, &route->addr, route->pfx_len);
+
+    lrs_idx_t i = _find(&addr, route->pfx_len, route->metric_type, NULL);
+    return (i != LRS_IDX_NONE) && (_data[i].flags & LRS_FLAG_NIB_INSTALLED);
+}
+
 void aodvv2_lrs_fill_routing_entry_rreq(aodvv2_message_t *msg,
-                                        aodvv2_local_route_t *rt_entry,
-                                        uint8_t link_cost)
+                                        aodvv2_local_route_t *rt_entry)
 {
     rt_entry->addr = msg->orig_node.addr;
     rt_entry->pfx_len = msg->orig_node.pfx_len;
     rt_entry->seqnum = msg->orig_node.seqnum;
     rt_entry->next_hop = msg->sender;
     rt_entry->last_used = msg->timestamp;
-    rt_entry->expiration_time = timex_add(msg->timestamp, validity_t);
+    rt_entry->expiration_time = msg->timestamp + validity_t;
     rt_entry->metric_type = msg->metric_type;
-    rt_entry->metric = msg->orig_node.metric + link_cost;
+    rt_entry->metric = msg->orig_node.metric;
     rt_entry->state = ROUTE_STATE_ACTIVE;
 }
 
 void aodvv2_lrs_fill_routing_entry_rrep(aodvv2_message_t *msg,
-                                        aodvv2_local_route_t *rt_entry,
-                                        uint8_t link_cost)
+                                        aodvv2_local_route_t *rt_entry)
 {
     rt_entry->addr = msg->targ_node.addr;
     rt_entry->pfx_len = msg->targ_node.pfx_len;
     rt_entry->seqnum = msg->targ_node.seqnum;
     rt_entry->next_hop = msg->sender;
     rt_entry->last_used = msg->timestamp;
-    rt_entry->expiration_time = timex_add(msg->timestamp, validity_t);
+    rt_entry->expiration_time = msg->timestamp + validity_t;
     rt_entry->metric_type = msg->metric_type;
-    rt_entry->metric = msg->targ_node.metric + link_cost;
+    rt_entry->metric = msg->targ_node.metric;
     rt_entry->state = ROUTE_STATE_ACTIVE;
 }
@@ -22,35 +22,129 @@
  */
 
 #include "net/aodvv2/conf.h"
+#include "net/aodvv2/lrs.h"
 #include "net/aodvv2/mcmsg.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
+/**
+ * @brief   Index of an entry on the set
+ */
+typedef uint16_t mcmsg_idx_t;
+
+/**
+ * @brief   Invalid @ref mcmsg_idx_t, used to terminate the chains
+ */
+#define MCMSG_IDX_NONE (UINT16_MAX)
+
 typedef struct {
     aodvv2_mcmsg_t data; /**< McMsg data */
+    uint32_t hash;       /**< Hash of the compatibility key */
+    mcmsg_idx_t next;    /**< Next entry on the bucket or the free list */
     bool used;           /**< Is this entry used? */
 } internal_entry_t;
 
 static internal_entry_t _entries[CONFIG_AODVV2_MCMSG_MAX_ENTRIES];
 static mutex_t _lock = MUTEX_INIT;
 
-static timex_t _max_seqnum_lifetime;
+/**
+ * @brief   Hash index keyed on OrigPrefix, OrigPrefixLength, TargPrefix and
+ *          MetricType, so compatible McMsgs share a bucket
+ */
+static mcmsg_idx_t _buckets[CONFIG_AODVV2_MCMSG_HASH_BUCKETS];
+static mcmsg_idx_t _free_head;
+
+/**
+ * @brief   Counting Bloom filter over the same key as `_buckets`
+ *
+ * A RREQ for a key that was never seen is added without walking the
+ * index.
+ */
+static uint8_t _bloom[CONFIG_AODVV2_MCMSG_BLOOM_SIZE];
+
+static uint32_t _max_seqnum_lifetime;
 
-static void _reset_entry_if_stale(internal_entry_t *entry)
+/**
+ * @brief   Number of live entries removed to make room for new ones
+ */
+static uint32_t _evictions;
+
+static uint32_t _hash(const ipv6_addr_t *orig_prefix, uint8_t orig_pfx_len,
+                      const ipv6_addr_t *targ_prefix,
+                      routing_metric_t metric_type)
 {
-    if (!entry->used) {
-        return;
+    uint32_t h = ((uint32_t)orig_pfx_len << 8) | (uint32_t)metric_type;
+
+    for (unsigned i = 0; i < 4; i++) {
+        h = (h * 31) ^ orig_prefix->u32[i].u32;
+        h = (h * 31) ^ targ_prefix->u32[i].u32;
+    }
+
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static inline unsigned _bloom_idx(uint32_t hash, unsigned k)
+{
+    /* Double hashing, the second hash must be odd */
+    return (hash + k * ((hash >> 16) | 1)) % CONFIG_AODVV2_MCMSG_BLOOM_SIZE;
+}
+
+static bool _bloom_test(uint32_t hash)
+{
+    return _bloom[_bloom_idx(hash, 0)] && _bloom[_bloom_idx(hash, 1)];
+}
+
+static void _bloom_add(uint32_t hash)
+{
+    for (unsigned k = 0; k < 2; k++) {
+        uint8_t *counter = &_bloom[_bloom_idx(hash, k)];
+        /* A saturated counter stays so, it can't tell how many to remove */
+        if (*counter < UINT8_MAX) {
+            (*counter)++;
+        }
     }
+}
 
-    timex_t current_time;
-    xtimer_now_timex(&current_time);
+static void _bloom_del(uint32_t hash)
+{
+    for (unsigned k = 0; k < 2; k++) {
+        uint8_t *counter = &_bloom[_bloom_idx(hash, k)];
+        if (*counter > 0 && *counter < UINT8_MAX) {
+            (*counter)--;
+        }
+    }
+}
 
-    if (timex_cmp(current_time, entry->data.removal_time) == 1) {
-        DEBUG_PUTS("aodvv2: McMsg is stale");
-        memset(&entry->data, 0, sizeof(entry->data));
-        entry->used = false;
+static inline bool _is_stale(const internal_entry_t *entry, uint32_t now)
+{
+    return (int32_t)(now - entry->data.removal_time) > 0;
+}
+
+/*
+ * Unlink entry i, preceded by prev on its bucket, and free it
+ */
+static void _remove(mcmsg_idx_t i, mcmsg_idx_t prev)
+{
+    internal_entry_t *entry = &_entries[i];
+
+    if (prev == MCMSG_IDX_NONE) {
+        _buckets[entry->hash % ARRAY_SIZE(_buckets)] = entry->next;
+    }
+    else {
+        _entries[prev].next = entry->next;
     }
+
+    _bloom_del(entry->hash);
+
+    memset(&entry->data, 0, sizeof(entry->data));
+    entry->used = false;
+    entry->next = _free_head;
+    _free_head = i;
 }
 
 static inline bool _is_compatible_mcmsg(aodvv2_mcmsg_t *lhs, aodvv2_mcmsg_t *rhs)
@@ -100,47 +194,122 @@ static inline bool _is_comparable(aodvv2_mcmsg_t *entry, aodvv2_message_t *msg)
     return false;
 }
 
-static internal_entry_t *_find_comparable_entry(aodvv2_message_t *msg)
+/*
+ * Walk the bucket of hash, dropping the stale entries on the way
+ */
+static internal_entry_t *_find_comparable_entry(aodvv2_message_t *msg,
+                                                uint32_t hash, uint32_t now)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
+    internal_entry_t *comparable = NULL;
+    mcmsg_idx_t prev = MCMSG_IDX_NONE;
+    mcmsg_idx_t i = _buckets[hash % ARRAY_SIZE(_buckets)];
+
+    while (i != MCMSG_IDX_NONE) {
         internal_entry_t *entry = &_entries[i];
-        _reset_entry_if_stale(entry);
+        mcmsg_idx_t next = entry->next;
 
-        if (entry->used) {
-            if (_is_comparable(&entry->data, msg)) {
-                return entry;
-            }
+        if (_is_stale(entry, now)) {
+            DEBUG_PUTS("aodvv2: McMsg is stale");
+            _remove(i, prev);
+            i = next;
+            continue;
+        }
+
+        if (comparable == NULL && entry->hash == hash &&
+            _is_comparable(&entry->data, msg)) {
+            comparable = entry;
         }
+
+        prev = i;
+        i = next;
     }
 
-    return NULL;
+    return comparable;
 }
 
-static internal_entry_t *_add(aodvv2_message_t *msg)
+/*
+ * Free an entry when the set is full: drop all the stale entries, or if there
+ * are none, the one that would be removed first, i.e. the least recently
+ * updated one.
+ */
+static void _evict(uint32_t now)
 {
-    /* Find empty McMsg and fill it */
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned bucket = 0; bucket < ARRAY_SIZE(_buckets); bucket++) {
+        mcmsg_idx_t prev = MCMSG_IDX_NONE;
+        mcmsg_idx_t i = _buckets[bucket];
+
+        while (i != MCMSG_IDX_NONE) {
+            mcmsg_idx_t next = _entries[i].next;
+            if (_is_stale(&_entries[i], now)) {
+                _remove(i, prev);
+            }
+            else {
+                prev = i;
+            }
+            i = next;
+        }
+    }
 
-        if (!entry->used) {
-            timex_t current_time;
-            xtimer_now_timex(&current_time);
-
-            entry->used = true;
-            entry->data.orig_prefix = msg->orig_node.addr;
-            entry->data.orig_pfx_len = msg->orig_node.pfx_len;
-            entry->data.targ_prefix = msg->targ_node.addr;
-            entry->data.metric_type = msg->metric_type;
-            entry->data.metric = msg->orig_node.metric;
-            entry->data.orig_seqnum = msg->orig_node.seqnum;
-
-            entry->data.timestamp = current_time;
-            entry->data.removal_time = timex_add(current_time, _max_seqnum_lifetime);
-            return entry;
+    if (_free_head != MCMSG_IDX_NONE) {
+        return;
+    }
+
+    mcmsg_idx_t victim = 0;
+    for (unsigned i = 1; i < ARRAY_SIZE(_entries); i++) {
+        if ((int32_t)(_entries[i].data.removal_time -
+                      _entries[victim].data.removal_time) < 0) {
+            victim = i;
         }
     }
 
-    return NULL;
+    /* Find its predecessor on the bucket to unlink it */
+    mcmsg_idx_t prev = MCMSG_IDX_NONE;
+    mcmsg_idx_t i = _buckets[_entries[victim].hash % ARRAY_SIZE(_buckets)];
+    while (i != victim) {
+        prev = i;
+        i = _entries[i].next;
+    }
+
+    DEBUG_PUTS("aodvv2: McMsg set is full, evicting least recently updated");
+    _remove(victim, prev);
+    _evictions++;
+}
+
+static internal_entry_t *_add(aodvv2_message_t *msg, uint32_t hash,
+                              uint32_t now)
+{
+    if (_free_head == MCMSG_IDX_NONE) {
+        _evict(now);
+    }
+
+    /* Take an empty McMsg and fill it */
+    mcmsg_idx_t i = _free_head;
+    if (i == MCMSG_IDX_NONE) {
+        return NULL;
+    }
+
+    internal_entry_t *entry = &_entries[i];
+    _free_head = entry->next;
+
+    entry->used = true;
+    entry->data.orig_prefix = msg->orig_node.addr;
+    entry->data.orig_pfx_len = msg->orig_node.pfx_len;
+    entry->data.targ_prefix = msg->targ_node.addr;
+    entry->data.metric_type = msg->metric_type;
+    entry->data.metric = msg->orig_node.metric;
+    entry->data.orig_seqnum = msg->orig_node.seqnum;
+    entry->data.seqnortr = msg->seqnortr;
+
+    entry->data.timestamp = now;
+    entry->data.removal_time = now + _max_seqnum_lifetime;
+
+    unsigned bucket = hash % ARRAY_SIZE(_buckets);
+    entry->hash = hash;
+    entry->next = _buckets[bucket];
+    _buckets[bucket] = i;
+    _bloom_add(hash);
+
+    return entry;
 }
 
 void aodvv2_mcmsg_init(void)
@@ -148,22 +317,52 @@ void aodvv2_mcmsg_init(void)
     DEBUG_PUTS("aodvv2: init McMset set");
     mutex_lock(&_lock);
 
-    _max_seqnum_lifetime = timex_set(CONFIG_AODVV2_MAX_SEQNUM_LIFETIME, 0);
+    _max_seqnum_lifetime = CONFIG_AODVV2_MAX_SEQNUM_LIFETIME * MS_PER_SEC;
 
     memset(&_entries, 0, sizeof(_entries));
+    memset(&_bloom, 0, sizeof(_bloom));
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_buckets); i++) {
+        _buckets[i] = MCMSG_IDX_NONE;
+    }
+
+    /* All entries start on the free list */
+    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
+        _entries[i].next = (i + 1 < ARRAY_SIZE(_entries))
+                         ? (mcmsg_idx_t)(i + 1) : MCMSG_IDX_NONE;
+    }
+    _free_head = 0;
+    _evictions = 0;
+
+    mutex_unlock(&_lock);
+}
+
+uint32_t aodvv2_mcmsg_evictions(void)
+{
+    mutex_lock(&_lock);
+    uint32_t evictions = _evictions;
     mutex_unlock(&_lock);
+
+    return evictions;
 }
 
 int aodvv2_mcmsg_process(aodvv2_message_t *msg)
 {
     mutex_lock(&_lock);
 
-    internal_entry_t *comparable = _find_comparable_entry(msg);
+    uint32_t now = aodvv2_lrs_now();
+    uint32_t hash = _hash(&msg->orig_node.addr, msg->orig_node.pfx_len,
+                          &msg->targ_node.addr, msg->metric_type);
+
+    /* Nothing compatible was seen, skip the index */
+    internal_entry_t *comparable = NULL;
+    if (_bloom_test(hash)) {
+        comparable = _find_comparable_entry(msg, hash, now);
+    }
+
     if (comparable == NULL) {
         DEBUG_PUTS("aodvv2: adding new McMsg");
-        if (_add(msg) == NULL) {
-            DEBUG_PUTS("aodvv2: McMsg set is full");
-        }
+        _add(msg, hash, now);
         mutex_unlock(&_lock);
         return AODVV2_MCMSG_OK;
     }
@@ -171,11 +370,8 @@ int aodvv2_mcmsg_process(aodvv2_message_t *msg)
     DEBUG_PUTS("aodvv2: comparable McMsg found");
 
     /* There's a comparable entry, update it's timing information */
-    timex_t current_time;
-    xtimer_now_timex(&current_time);
-
-    comparable->data.timestamp = current_time;
-    comparable->data.removal_time = timex_add(current_time, _max_seqnum_lifetime);
+    comparable->data.timestamp = now;
+    comparable->data.removal_time = now + _max_seqnum_lifetime;
 
     int seqcmp = aodvv2_seqnum_cmp(comparable->data.orig_seqnum, msg->orig_node.seqnum);
     if (seqcmp < 0) {
@@ -199,22 +395,22 @@ int aodvv2_mcmsg_process(aodvv2_message_t *msg)
     comparable->data.orig_seqnum = msg->orig_node.seqnum;
     comparable->data.metric = msg->orig_node.metric;
 
-    /* Search for compatible entries and compare their metrics */
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
+    /* Search for compatible entries and compare their metrics, they're all on
+     * the same bucket, and the stale ones were already removed */
+    mcmsg_idx_t i = _buckets[hash % ARRAY_SIZE(_buckets)];
+    while (i != MCMSG_IDX_NONE) {
         internal_entry_t *entry = &_entries[i];
-        if (entry == comparable) {
+        i = entry->next;
+
+        if (entry == comparable || entry->hash != hash) {
             continue;
         }
 
-        _reset_entry_if_stale(entry);
-
-        if (entry->used && entry != comparable) {
-            if (_is_compatible_mcmsg(&comparable->data, &entry->data)) {
-                if (entry->data.metric <= comparable->data.metric) {
-                    DEBUG_PUTS("aodvv2: received McMsg is worse than stored");
-                    mutex_unlock(&_lock);
-                    return AODVV2_MCMSG_REDUNDANT;
-                }
+        if (_is_compatible_mcmsg(&comparable->data, &entry->data)) {
+            if (entry->data.metric <= comparable->data.metric) {
+                DEBUG_PUTS("aodvv2: received McMsg is worse than stored");
+                mutex_unlock(&_lock);
+                return AODVV2_MCMSG_REDUNDANT;
             }
         }
     }
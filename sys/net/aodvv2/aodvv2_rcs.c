@@ -21,6 +21,9 @@
  * @}
  */
 
+#include <errno.h>
+#include <stdatomic.h>
+
 #include "net/aodvv2/rcs.h"
 
 #include "mutex.h"
@@ -30,145 +33,229 @@
 
 /**
  * @brief   Memory for the Client Set entries.
+ *
+ * The first `_entries_num` entries are used, sorted by prefix length,
+ * longest first, so the first match is the longest prefix match.
  */
-typedef struct {
-    aodvv2_rcs_entry_t data; /**< Client data */
-    bool used; /**< Is this entry used? */
-} internal_entry_t;
+static aodvv2_rcs_entry_t _entries[CONFIG_AODVV2_RCS_ENTRIES];
+static unsigned _entries_num;
 
-static internal_entry_t _entries[CONFIG_AODVV2_RCS_ENTRIES];
+/**
+ * @brief   Serializes the writers
+ */
 static mutex_t _lock = MUTEX_INIT;
 
-void aodvv2_rcs_init(void)
+/**
+ * @brief   Sequence counter of the set, odd while a writer is modifying it
+ *
+ * Readers don't take any lock, they retry when the counter changed while
+ * they were reading.
+ */
+static atomic_uint _seq;
+
+static void _write_begin(void)
 {
     mutex_lock(&_lock);
-    memset(_entries, 0, sizeof(_entries));
+    atomic_fetch_add_explicit(&_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void _write_end(void)
+{
+    atomic_fetch_add_explicit(&_seq, 1, memory_order_release);
     mutex_unlock(&_lock);
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_add(const ipv6_addr_t *addr, uint8_t pfx_len,
-                                   const uint8_t cost)
+static unsigned _read_begin(void)
+{
+    unsigned seq;
+
+    while ((seq = atomic_load_explicit(&_seq, memory_order_acquire)) & 1) {
+        /* A writer is in the middle of an update. Spinning could starve it
+         * if it has a lower priority, so wait for it to finish instead */
+        mutex_lock(&_lock);
+        mutex_unlock(&_lock);
+    }
+
+    return seq;
+}
+
+static bool _read_retry(unsigned seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&_seq, memory_order_relaxed) != seq;
+}
+
+/*
+ * Find the entry for (addr, pfx_len), only to be called by writers
+ */
+static int _find(const ipv6_addr_t *addr, uint8_t pfx_len)
+{
+    for (unsigned i = 0; i < _entries_num; i++) {
+        if ((_entries[i].pfx_len == pfx_len) &&
+            (ipv6_addr_match_prefix(&_entries[i].addr, addr) >= pfx_len)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void aodvv2_rcs_init(void)
 {
+    _write_begin();
+    memset(_entries, 0, sizeof(_entries));
+    _entries_num = 0;
+    _write_end();
+}
+
+int aodvv2_rcs_add(const ipv6_addr_t *addr, uint8_t pfx_len,
+                   const uint8_t cost)
+{
+    assert(addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    const aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(addr, pfx_len);
-    if (entry != NULL) {
+    _write_begin();
+
+    if (_find(addr, pfx_len) >= 0) {
         DEBUG_PUTS("aodvv2: client exists, not adding it");
-        return NULL;
+        _write_end();
+        return -EEXIST;
     }
 
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
-
-        /* Find free spot to place the new entry. */
-        if (!entry->used) {
-            ipv6_addr_init_prefix(&entry->data.addr, addr, pfx_len);
-            entry->data.pfx_len = pfx_len;
-            entry->data.cost = cost;
-
-            entry->used = true;
+    if (_entries_num == ARRAY_SIZE(_entries)) {
+        DEBUG_PUTS("aodvv2: router client set is full");
+        _write_end();
+        return -ENOSPC;
+    }
 
-            mutex_unlock(&_lock);
-            return &entry->data;
+    /* Insert keeping the entries sorted, longest prefix first */
+    unsigned pos;
+    for (pos = 0; pos < _entries_num; pos++) {
+        if (_entries[pos].pfx_len < pfx_len) {
+            break;
         }
     }
+    memmove(&_entries[pos + 1], &_entries[pos],
+            (_entries_num - pos) * sizeof(aodvv2_rcs_entry_t));
 
-    DEBUG_PUTS("aodvv2: router client set is full");
-    mutex_unlock(&_lock);
-    return NULL;
+    /* The slot still holds the client that was moved, only the prefix bits
+     * are written so clear it first */
+    _entries[pos].addr = ipv6_addr_unspecified;
+    ipv6_addr_init_prefix(&_entries[pos].addr, addr, pfx_len);
+    _entries[pos].pfx_len = pfx_len;
+    _entries[pos].cost = cost;
+    _entries_num++;
+
+    _write_end();
+    return 0;
 }
 
 void aodvv2_rcs_del(const ipv6_addr_t *addr, uint8_t pfx_len)
 {
+    assert(addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(addr, pfx_len);
+    _write_begin();
 
-    if (!entry) {
+    int pos = _find(addr, pfx_len);
+    if (pos < 0) {
         DEBUG_PUTS("aodvv2: client not found\n");
+        _write_end();
         return;
     }
 
-    mutex_lock(&_lock);
-    internal_entry_t *internal = container_of(entry, internal_entry_t, data);
-    memset(&internal->data, 0, sizeof(aodvv2_rcs_entry_t));
-    internal->used = false;
-    mutex_unlock(&_lock);
+    _entries_num--;
+    memmove(&_entries[pos], &_entries[pos + 1],
+            (_entries_num - pos) * sizeof(aodvv2_rcs_entry_t));
+    memset(&_entries[_entries_num], 0, sizeof(aodvv2_rcs_entry_t));
+
+    _write_end();
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_matches(const ipv6_addr_t *addr,
-                                       uint8_t pfx_len)
+bool aodvv2_rcs_matches(const ipv6_addr_t *addr, uint8_t pfx_len,
+                        aodvv2_rcs_entry_t *entry)
 {
+    assert(addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    bool found;
+    aodvv2_rcs_entry_t tmp;
+    unsigned seq;
 
-        /* Skip unused entries */
-        if (!entry->used) {
-            continue;
-        }
+    do {
+        seq = _read_begin();
+        found = false;
 
-        /* Compare addresses by prefix */
-        if ((entry->data.pfx_len == pfx_len) &&
-            (ipv6_addr_match_prefix(&entry->data.addr,
-                                   addr) >= entry->data.pfx_len)) {
-            mutex_unlock(&_lock);
-            return &entry->data;
+        for (unsigned i = 0; i < _entries_num; i++) {
+            /* Compare addresses by prefix */
+            if ((_entries[i].pfx_len == pfx_len) &&
+                (ipv6_addr_match_prefix(&_entries[i].addr,
+                                        addr) >= pfx_len)) {
+                tmp = _entries[i];
+                found = true;
+                break;
+            }
         }
-    }
+    } while (_read_retry(seq));
 
-    /* No entry matches */
-    mutex_unlock(&_lock);
-    return NULL;
+    if (found && entry) {
+        *entry = tmp;
+    }
+    return found;
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_is_client(const ipv6_addr_t *addr)
+bool aodvv2_rcs_is_client(const ipv6_addr_t *addr, aodvv2_rcs_entry_t *entry)
 {
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    assert(addr != NULL);
 
-        /* Skip unused entries */
-        if (!entry->used) {
-            continue;
-        }
+    bool found;
+    aodvv2_rcs_entry_t tmp;
+    unsigned seq;
+
+    do {
+        seq = _read_begin();
+        found = false;
 
-        /* Compare addresses by prefix */
-        if (ipv6_addr_match_prefix(&entry->data.addr,
-                                   addr) >= entry->data.pfx_len) {
-            mutex_unlock(&_lock);
-            return &entry->data;
+        /* Entries are sorted longest prefix first, so the first match is
+         * the longest one */
+        for (unsigned i = 0; i < _entries_num; i++) {
+            if (ipv6_addr_match_prefix(&_entries[i].addr,
+                                       addr) >= _entries[i].pfx_len) {
+                tmp = _entries[i];
+                found = true;
+                break;
+            }
         }
+    } while (_read_retry(seq));
+
+    if (found && entry) {
+        *entry = tmp;
     }
-    mutex_unlock(&_lock);
-    return NULL;
+    return found;
 }
 
 void aodvv2_rcs_print_entries(void)
 {
     char buf[IPV6_ADDR_MAX_STR_LEN];
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
 
-        /* Skip unused entries */
-        if (!entry->used) {
-            continue;
-        }
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < _entries_num; i++) {
+        aodvv2_rcs_entry_t *entry = &_entries[i];
 
         /* prints ipv6/prefix | cost */
         printf("%s/%u | %u\n",
-               ipv6_addr_to_str(buf, &entry->data.addr, sizeof(buf)),
-               entry->data.pfx_len, entry->data.cost);
+               ipv6_addr_to_str(buf, &entry->addr, sizeof(buf)),
+               entry->pfx_len, entry->cost);
     }
     mutex_unlock(&_lock);
 }
@@ -21,8 +21,11 @@
  * @}
  */
 
+#include <string.h>
+
 #include "aodvv2_reader.h"
 #include "net/aodvv2.h"
+#include "net/aodvv2/discovery.h"
 #include "net/aodvv2/lrs.h"
 #include "net/aodvv2/mcmsg.h"
 #include "net/aodvv2/metric.h"
@@ -30,8 +33,6 @@
 #include "net/aodvv2/rfc5444.h"
 #include "net/manet.h"
 
-#include "net/gnrc/ipv6/nib/ft.h"
-
 #include "xtimer.h"
 
 #include "rfc5444_compat.h"
@@ -39,8 +40,8 @@
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-#define AODVV2_ROUTE_LIFETIME \
-    (CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME)
+static enum rfc5444_result _cb_message_start(
+    struct rfc5444_reader_tlvblock_context *cont);
 
 static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
     struct rfc5444_reader_tlvblock_context *cont);
@@ -60,9 +61,10 @@ static enum rfc5444_result _cb_rreq_end_callback(
  * Message consumer, will be called once for every message of
  * type RFC5444_MSGTYPE_RREP that contains all the mandatory message TLVs
  */
-static struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREP,
+    .start_callback = _cb_message_start,
     .block_callback = _cb_rrep_blocktlv_messagetlvs_okay,
     .end_callback = _cb_rrep_end_callback,
 };
@@ -71,7 +73,7 @@ static struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
  * Address consumer. Will be called once for every address in a message of
  * type RFC5444_MSGTYPE_RREP.
  */
-static struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREP,
     .addrblock_consumer = true,
@@ -82,9 +84,10 @@ static struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
  * Message consumer, will be called once for every message of
  * type RFC5444_MSGTYPE_RREQ that contains all the mandatory message TLVs
  */
-static struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREQ,
+    .start_callback = _cb_message_start,
     .block_callback = _cb_rreq_blocktlv_messagetlvs_okay,
     .end_callback = _cb_rreq_end_callback,
 };
@@ -93,7 +96,7 @@ static struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
  * Address consumer. Will be called once for every address in a message of
  * type RFC5444_MSGTYPE_RREQ.
  */
-static struct rfc5444_reader_tlvblock_consumer _rreq_address_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rreq_address_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREQ,
     .addrblock_consumer = true,
@@ -101,89 +104,112 @@ static struct rfc5444_reader_tlvblock_consumer _rreq_address_consumer =
 };
 
 /*
- * Address consumer entries definition
- * TLV types RFC5444_MSGTLV__SEQNUM and RFC5444_MSGTLV_METRIC
+ * Address consumer entries definition. Every address consumer needs its own
+ * copy, the RFC5444 reader links them into the consumer.
  */
-static struct rfc5444_reader_tlvblock_consumer_entry _address_consumer_entries[] =
+static const struct rfc5444_reader_tlvblock_consumer_entry
+    _address_consumer_entries[AODVV2_READER_ADDRESS_TLVS] =
 {
     [RFC5444_MSGTLV_ORIGSEQNUM] = { .type = RFC5444_MSGTLV_ORIGSEQNUM },
     [RFC5444_MSGTLV_TARGSEQNUM] = { .type = RFC5444_MSGTLV_TARGSEQNUM },
+    [RFC5444_MSGTLV_UNREACHABLE_NODE_SEQNUM] = {
+        .type = RFC5444_MSGTLV_UNREACHABLE_NODE_SEQNUM
+    },
     [RFC5444_MSGTLV_METRIC] = { .type = RFC5444_MSGTLV_METRIC }
 };
 
-static struct netaddr_str nbuf;
-static aodvv2_message_t _msg_data;
+static inline aodvv2_reader_t *_reader_of(
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    return container_of(cont->reader, aodvv2_reader_t, reader);
+}
 
-static kernel_pid_t _netif_pid = KERNEL_PID_UNDEF;
+static enum rfc5444_result _cb_message_start(
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    aodvv2_reader_t *r = _reader_of(cont);
+
+    /* Parse every message from scratch, only the sender is shared by the
+     * messages of a packet */
+    memset(&r->msg, 0, sizeof(r->msg));
+    r->msg.sender = r->sender;
+
+    return RFC5444_OKAY;
+}
 
 static enum rfc5444_result _cb_rrep_blocktlv_messagetlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_message_t *msg = &_reader_of(cont)->msg;
+
     if (!cont->has_hoplimit) {
         DEBUG_PUTS("aodvv2: missing hop limit");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    _msg_data.msg_hop_limit = cont->hoplimit;
-    if (_msg_data.msg_hop_limit == 0) {
+    msg->msg_hop_limit = cont->hoplimit;
+    if (msg->msg_hop_limit == 0) {
         DEBUG_PUTS("aodvv2: hop limit is 0");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    _msg_data.msg_hop_limit--;
+    msg->msg_hop_limit--;
     return RFC5444_OKAY;
 }
 
 static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *r = _reader_of(cont);
+    aodvv2_message_t *msg = &r->msg;
+    struct netaddr_str nbuf;
     struct rfc5444_reader_tlvblock_entry *tlv;
     bool is_targ_node_addr = false;
 
     DEBUG("aodvv2: %s\n", netaddr_to_string(&nbuf, &cont->addr));
 
     /* handle TargNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
+    tlv = r->rrep_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_TARGSEQNUM: %d\n", *tlv->single_value);
         is_targ_node_addr = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.targ_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &msg->targ_node.addr,
+                             &msg->targ_node.pfx_len);
+        msg->targ_node.seqnum = *tlv->single_value;
     }
 
     /* handle OrigNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
+    tlv = r->rrep_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_ORIGSEQNUM: %d\n", *tlv->single_value);
         is_targ_node_addr = false;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.orig_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.orig_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &msg->orig_node.addr,
+                             &msg->orig_node.pfx_len);
+        msg->orig_node.seqnum = *tlv->single_value;
     }
 
     if (!tlv && !is_targ_node_addr) {
         DEBUG_PUTS("aodvv2: mandatory SeqNum TLV missing!");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_METRIC].tlv;
+    tlv = r->rrep_entries[RFC5444_MSGTLV_METRIC].tlv;
     if (!tlv && is_targ_node_addr) {
         DEBUG_PUTS("aodvv2: missing or unknown metric TLV!");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
     if (tlv) {
         if (!is_targ_node_addr) {
             DEBUG_PUTS("aodvv2: metric TLV belongs to wrong address!");
-            return RFC5444_DROP_PACKET;
+            return RFC5444_DROP_MESSAGE;
         }
 
         DEBUG("aodvv2: RFC5444_MSGTLV_METRIC val: %d, exttype: %d\n",
               *tlv->single_value, tlv->type_ext);
 
-        _msg_data.metric_type = tlv->type_ext;
-        _msg_data.orig_node.metric = *tlv->single_value;
+        msg->metric_type = tlv->type_ext;
+        msg->targ_node.metric = *tlv->single_value;
     }
 
     return RFC5444_OKAY;
@@ -192,102 +218,95 @@ static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
 static enum rfc5444_result _cb_rrep_end_callback(
         struct rfc5444_reader_tlvblock_context *cont, bool dropped)
 {
-    (void)cont;
+    aodvv2_message_t *msg = &_reader_of(cont)->msg;
 
-    /* Check if packet contains the required information */
+    /* Check if the message contains the required information */
     if (dropped) {
-        DEBUG_PUTS("aodvv2: dropping packet");
-        return RFC5444_DROP_PACKET;
+        DEBUG_PUTS("aodvv2: dropping message");
+        return RFC5444_DROP_MESSAGE;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.orig_node.addr) ||
-        _msg_data.orig_node.seqnum == 0) {
+    if (ipv6_addr_is_unspecified(&msg->orig_node.addr) ||
+        msg->orig_node.seqnum == 0) {
         DEBUG_PUTS("aodvv2: missing OrigNode Address or SeqNum");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.targ_node.addr) ||
-        _msg_data.targ_node.seqnum == 0) {
+    if (ipv6_addr_is_unspecified(&msg->targ_node.addr) ||
+        msg->targ_node.seqnum == 0) {
         DEBUG_PUTS("aodvv2: missing TargNode Address or SeqNum");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    uint8_t link_cost = aodvv2_metric_link_cost(_msg_data.metric_type);
+    uint8_t link_cost = aodvv2_metric_link_cost(msg->metric_type);
 
-    if ((aodvv2_metric_max(_msg_data.metric_type) - link_cost) <=
-        _msg_data.targ_node.metric) {
+    if ((aodvv2_metric_max(msg->metric_type) - link_cost) <=
+        msg->targ_node.metric) {
         DEBUG_PUTS("aodvv2: metric limit reached");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    aodvv2_metric_update(_msg_data.metric_type, &_msg_data.targ_node.metric);
+    aodvv2_metric_update(msg->metric_type, &msg->targ_node.metric);
 
-    /* Update packet timestamp */
-    timex_t now;
-    xtimer_now_timex(&now);
-    _msg_data.timestamp = now;
+    /* Update message timestamp */
+    msg->timestamp = aodvv2_lrs_now();
 
     /* for every relevant address (RteMsg.Addr) in the RteMsg, HandlingRtr
     searches its route table to see if there is a route table entry with the
     same MetricType of the RteMsg, matching RteMsg.Addr. */
 
-    aodvv2_local_route_t *rt_entry =
-        aodvv2_lrs_get_entry(&_msg_data.targ_node.addr, _msg_data.metric_type);
+    aodvv2_local_route_t rt_entry;
 
-    if (!rt_entry || (rt_entry->metric_type != _msg_data.metric_type)) {
+    if (!aodvv2_lrs_get_entry(&msg->targ_node.addr, msg->targ_node.pfx_len,
+                              msg->metric_type, &rt_entry)) {
         DEBUG_PUTS("aodvv2: creating new Local Route");
 
         aodvv2_local_route_t tmp = {0};
-        aodvv2_lrs_fill_routing_entry_rrep(&_msg_data, &tmp, link_cost);
-        aodvv2_lrs_add_entry(&tmp);
-
-        /* Add entry to NIB forwarding table */
-        DEBUG_PUTS("aodvv2: adding Local Route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&_msg_data.targ_node.addr,
-                                 _msg_data.targ_node.pfx_len, &_msg_data.sender,
-                                 _netif_pid, AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
+        aodvv2_lrs_fill_routing_entry_rrep(msg, &tmp);
+        if (!aodvv2_lrs_add_entry(&tmp)) {
+            DEBUG_PUTS("aodvv2: couldn't add Local Route");
         }
     }
     else {
-        if (!aodvv2_lrs_offers_improvement(rt_entry, &_msg_data.targ_node)) {
+        if (!aodvv2_lrs_offers_improvement(&rt_entry, &msg->targ_node)) {
             DEBUG_PUTS("aodvv2: RREP offers no improvement over known route");
-            return RFC5444_DROP_PACKET;
+            aodvv2_lrs_add_alternate(&rt_entry, &msg->targ_node,
+                                     &msg->sender, link_cost);
+            return RFC5444_DROP_MESSAGE;
         }
 
         /* The incoming routing information is better than existing routing
          * table information and SHOULD be used to improve the route table. */
         DEBUG_PUTS("aodvv2: updating Routing Table entry");
-        aodvv2_lrs_fill_routing_entry_rrep(&_msg_data, rt_entry, link_cost);
-
-        /* Add entry to nib forwarding table */
-        gnrc_ipv6_nib_ft_del(&rt_entry->addr, rt_entry->pfx_len);
-
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&rt_entry->addr, rt_entry->pfx_len,
-                                 &rt_entry->next_hop, _netif_pid,
-                                 AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
-        }
+        aodvv2_lrs_fill_routing_entry_rrep(msg, &rt_entry);
+        aodvv2_lrs_update_entry(&rt_entry);
     }
 
-    if (aodvv2_rcs_is_client(&_msg_data.orig_node.addr) != NULL) {
-        DEBUG("aodvv2: {%" PRIu32 ":%" PRIu32 "}\n",
-              now.seconds, now.microseconds);
+    if (aodvv2_rcs_is_client(&msg->orig_node.addr, NULL)) {
+        DEBUG("aodvv2: {%" PRIu32 "}\n", msg->timestamp);
         DEBUG("aodvv2: this is my RREP (SeqNum: %d)\n",
-              _msg_data.orig_node.seqnum);
+              msg->orig_node.seqnum);
         DEBUG_PUTS("aodvv2: We are done here, thanks!");
 
-        /* Send buffered packets for this address */
-        aodvv2_buffer_dispatch(&_msg_data.targ_node.addr);
+        /* We requested this route, keep it fresh while it's being used */
+        aodvv2_lrs_set_refresh(&msg->targ_node.addr, msg->targ_node.pfx_len,
+                               msg->metric_type);
+
+        /* Send buffered packets for this prefix, the route has to be on the
+         * NIB before they reach it */
+        aodvv2_lrs_nib_sync();
+        aodvv2_discovery_done(&msg->targ_node.addr,
+                              msg->targ_node.pfx_len);
+        aodvv2_buffer_dispatch(&msg->targ_node.addr,
+                               msg->targ_node.pfx_len);
     }
     else {
         DEBUG_PUTS("aodvv2: not my RREP, passing it on to the next hop.");
 
         ipv6_addr_t *next_hop =
-            aodvv2_lrs_get_next_hop(&_msg_data.orig_node.addr,
-                                    _msg_data.metric_type);
-        aodvv2_send_rrep(&_msg_data, next_hop);
+            aodvv2_lrs_get_next_hop(&msg->orig_node.addr,
+                                    msg->metric_type);
+        aodvv2_send_rrep(msg, next_hop);
     }
     return RFC5444_OKAY;
 }
@@ -295,17 +314,19 @@ static enum rfc5444_result _cb_rrep_end_callback(
 static enum rfc5444_result _cb_rreq_blocktlv_messagetlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_message_t *msg = &_reader_of(cont)->msg;
+
     if (!cont->has_hoplimit) {
         DEBUG("aodvv2: missing hop limit\n");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    _msg_data.msg_hop_limit = cont->hoplimit;
-    if (_msg_data.msg_hop_limit == 0) {
+    msg->msg_hop_limit = cont->hoplimit;
+    if (msg->msg_hop_limit == 0) {
         DEBUG("aodvv2: Hoplimit is 0.\n");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
-    _msg_data.msg_hop_limit--;
+    msg->msg_hop_limit--;
 
     return RFC5444_OKAY;
 }
@@ -313,6 +334,9 @@ static enum rfc5444_result _cb_rreq_blocktlv_messagetlvs_okay(
 static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *r = _reader_of(cont);
+    aodvv2_message_t *msg = &r->msg;
+    struct netaddr_str nbuf;
     struct rfc5444_reader_tlvblock_entry *tlv;
     bool is_orig_node_addr = false;
     bool is_targ_node = false;
@@ -320,58 +344,58 @@ static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
     DEBUG("aodvv2: %s\n", netaddr_to_string(&nbuf, &cont->addr));
 
     /* handle OrigNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
+    tlv = r->rreq_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_ORIGSEQNUM: %d\n", *tlv->single_value);
         is_orig_node_addr = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.orig_node.addr,
-                             &_msg_data.orig_node.pfx_len);
-        _msg_data.orig_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &msg->orig_node.addr,
+                             &msg->orig_node.pfx_len);
+        msg->orig_node.seqnum = *tlv->single_value;
     }
 
     /* handle TargNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
+    tlv = r->rreq_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_TARGSEQNUM: %d\n", *tlv->single_value);
 
         is_targ_node = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.targ_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &msg->targ_node.addr,
+                             &msg->targ_node.pfx_len);
+        msg->targ_node.seqnum = *tlv->single_value;
     }
 
     if (!tlv && !is_orig_node_addr) {
         /* assume that tlv missing => targ_node Address */
         is_targ_node = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
+        netaddr_to_ipv6_addr(&cont->addr, &msg->targ_node.addr,
+                             &msg->targ_node.pfx_len);
     }
 
     if (!is_orig_node_addr && !is_targ_node) {
         DEBUG_PUTS("aodvv2: mandatory RFC5444_MSGTLV_ORIGSEQNUM TLV missing");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
     /* handle Metric TLV */
     /* cppcheck: suppress false positive on non-trivially initialized arrays.
      *           this is a known bug: http://trac.cppcheck.net/ticket/5497 */
     /* cppcheck-suppress arrayIndexOutOfBounds */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_METRIC].tlv;
+    tlv = r->rreq_entries[RFC5444_MSGTLV_METRIC].tlv;
     if (!tlv && is_orig_node_addr) {
         DEBUG_PUTS("aodvv2: missing or unknown metric TLV");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
     if (tlv) {
         if (!is_orig_node_addr) {
             DEBUG_PUTS("aodvv2: metric TLV belongs to wrong address");
-            return RFC5444_DROP_PACKET;
+            return RFC5444_DROP_MESSAGE;
         }
         DEBUG("aodvv2: RFC5444_MSGTLV_METRIC val: %d, exttype: %d\n",
                *tlv->single_value, tlv->type_ext);
 
-        _msg_data.metric_type = tlv->type_ext;
-        _msg_data.orig_node.metric = *tlv->single_value;
+        msg->metric_type = tlv->type_ext;
+        msg->orig_node.metric = *tlv->single_value;
     }
     return RFC5444_OKAY;
 }
@@ -379,98 +403,81 @@ static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
 static enum rfc5444_result _cb_rreq_end_callback(
     struct rfc5444_reader_tlvblock_context *cont, bool dropped)
 {
-    (void) cont;
-
+    aodvv2_message_t *msg = &_reader_of(cont)->msg;
 
-    /* Check if packet contains the required information */
+    /* Check if the message contains the required information */
     if (dropped) {
-        DEBUG_PUTS("aodvv2: dropping packet");
-        return RFC5444_DROP_PACKET;
+        DEBUG_PUTS("aodvv2: dropping message");
+        return RFC5444_DROP_MESSAGE;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.orig_node.addr) ||
-        _msg_data.orig_node.seqnum == 0) {
+    if (ipv6_addr_is_unspecified(&msg->orig_node.addr) ||
+        msg->orig_node.seqnum == 0) {
         DEBUG_PUTS("aodvv2: missing OrigNode Address or SeqNum");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.targ_node.addr)) {
+    if (ipv6_addr_is_unspecified(&msg->targ_node.addr)) {
         DEBUG_PUTS("aodvv2: missing TargNode Address");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    if (_msg_data.msg_hop_limit == 0) {
+    if (msg->msg_hop_limit == 0) {
         DEBUG_PUTS("aodvv2: hop limit is 0");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
-    uint8_t link_cost = aodvv2_metric_link_cost(_msg_data.metric_type);
-    if ((aodvv2_metric_max(_msg_data.metric_type) - link_cost) <=
-        _msg_data.orig_node.metric) {
+    uint8_t link_cost = aodvv2_metric_link_cost(msg->metric_type);
+    if ((aodvv2_metric_max(msg->metric_type) - link_cost) <=
+        msg->orig_node.metric) {
         DEBUG_PUTS("aodvv2: metric limit reached");
-        return RFC5444_DROP_PACKET;
+        return RFC5444_DROP_MESSAGE;
     }
 
     /* The incoming RREQ MUST be checked against previously received information */
-    if (aodvv2_mcmsg_process(&_msg_data) == AODVV2_MCMSG_REDUNDANT) {
-        DEBUG_PUTS("aodvv2: packet is redundant");
-        return RFC5444_DROP_PACKET;
+    if (aodvv2_mcmsg_process(msg) == AODVV2_MCMSG_REDUNDANT) {
+        DEBUG_PUTS("aodvv2: message is redundant");
+        return RFC5444_DROP_MESSAGE;
     }
 
-    aodvv2_metric_update(_msg_data.metric_type, &_msg_data.orig_node.metric);
+    aodvv2_metric_update(msg->metric_type, &msg->orig_node.metric);
 
-    /* Update packet timestamp */
-    timex_t now;
-    xtimer_now_timex(&now);
-    _msg_data.timestamp = now;
+    /* Update message timestamp */
+    msg->timestamp = aodvv2_lrs_now();
 
     /* For every relevant address (RteMsg.Addr) in the RteMsg, HandlingRtr
      * searches its route table to see if there is a route table entry with the
      * same MetricType of the RteMsg, matching RteMsg.Addr.
      */
-    aodvv2_local_route_t *rt_entry =
-        aodvv2_lrs_get_entry(&_msg_data.orig_node.addr,
-                             _msg_data.metric_type);
+    aodvv2_local_route_t rt_entry;
 
-    if (!rt_entry || (rt_entry->metric_type != _msg_data.metric_type)) {
+    if (!aodvv2_lrs_get_entry(&msg->orig_node.addr, msg->orig_node.pfx_len,
+                              msg->metric_type, &rt_entry)) {
         DEBUG_PUTS("aodvv2: creating new Local Route");
 
         aodvv2_local_route_t tmp = {0};
 
         /* Add this RREQ to LRS */
-        aodvv2_lrs_fill_routing_entry_rreq(&_msg_data, &tmp, link_cost);
-        aodvv2_lrs_add_entry(&tmp);
-
-        /* Add entry to NIB forwarding table */
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&_msg_data.orig_node.addr,
-                                 _msg_data.orig_node.pfx_len, &_msg_data.sender,
-                                 _netif_pid, AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
+        aodvv2_lrs_fill_routing_entry_rreq(msg, &tmp);
+        if (!aodvv2_lrs_add_entry(&tmp)) {
+            DEBUG_PUTS("aodvv2: couldn't add Local Route");
         }
     }
     else {
         /* If the route is already stored verify if this route offers an
          * improvement in path*/
-        if (!aodvv2_lrs_offers_improvement(rt_entry, &_msg_data.orig_node)) {
-            DEBUG_PUTS("aodvv2: packet offers no improvement over known route");
-            return RFC5444_DROP_PACKET;
+        if (!aodvv2_lrs_offers_improvement(&rt_entry, &msg->orig_node)) {
+            DEBUG_PUTS("aodvv2: message offers no improvement over known route");
+            aodvv2_lrs_add_alternate(&rt_entry, &msg->orig_node,
+                                     &msg->sender, link_cost);
+            return RFC5444_DROP_MESSAGE;
         }
 
         /* The incoming routing information is better than existing routing
          * table information and SHOULD be used to improve the route table. */
         DEBUG_PUTS("aodvv2: updating Local Route");
-        aodvv2_lrs_fill_routing_entry_rreq(&_msg_data, rt_entry, link_cost);
-
-        /* Add entry to nib forwarding table */
-        gnrc_ipv6_nib_ft_del(&rt_entry->addr, rt_entry->pfx_len);
-
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&rt_entry->addr, rt_entry->pfx_len,
-                                 &rt_entry->next_hop, _netif_pid,
-                                 AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
-        }
+        aodvv2_lrs_fill_routing_entry_rreq(msg, &rt_entry);
+        aodvv2_lrs_update_entry(&rt_entry);
     }
 
     /* If TargNode is a client of the router receiving the RREQ, then the
@@ -478,48 +485,76 @@ static enum rfc5444_result _cb_rreq_end_callback(
      * subsequently processing for the RREQ is complete.  Otherwise,
      * processing continues as follows.
      */
-    if (aodvv2_rcs_is_client(&_msg_data.targ_node.addr) != NULL) {
+    aodvv2_rcs_entry_t client;
+    if (aodvv2_rcs_is_client(&msg->targ_node.addr, &client)) {
         DEBUG_PUTS("aodvv2: TargNode is on client list, sending RREP");
 
+        /* Reply with the whole client prefix, so a single route serves
+         * every address within it */
+        msg->targ_node.addr = client.addr;
+        msg->targ_node.pfx_len = client.pfx_len;
+
         /* Make sure to start with a clean metric value */
-        _msg_data.targ_node.metric = 0;
+        msg->targ_node.metric = 0;
 
-        aodvv2_send_rrep(&_msg_data, &_msg_data.sender);
+        aodvv2_send_rrep(msg, &msg->sender);
     }
     else {
         DEBUG_PUTS("aodvv2: I'm not TargNode, forwarding RREQ");
-        aodvv2_send_rreq(&_msg_data, &ipv6_addr_all_manet_routers_link_local);
+        aodvv2_send_rreq(msg, &ipv6_addr_all_manet_routers_link_local);
     }
 
     return RFC5444_OKAY;
 }
 
-void aodvv2_reader_init(struct rfc5444_reader *reader, kernel_pid_t netif_pid)
+void aodvv2_reader_init(aodvv2_reader_t *reader)
 {
-    assert(reader != NULL && netif_pid != KERNEL_PID_UNDEF);
-
-    if (_netif_pid == KERNEL_PID_UNDEF) {
-        _netif_pid = netif_pid;
-    }
-
-    rfc5444_reader_add_message_consumer(reader, &_rrep_consumer,
+    assert(reader != NULL);
+
+    memset(reader, 0, sizeof(*reader));
+
+    /* Parse without touching the heap */
+    reader->reader.arena.tlvs = reader->tlvs;
+    reader->reader.arena.tlv_count = ARRAY_SIZE(reader->tlvs);
+    reader->reader.arena.addrs = reader->addrs;
+    reader->reader.arena.addr_count = ARRAY_SIZE(reader->addrs);
+    reader->reader.arena.heap_fallback =
+        IS_ACTIVE(CONFIG_AODVV2_RFC5444_READER_HEAP);
+    rfc5444_reader_init(&reader->reader);
+
+    reader->rrep = _rrep_consumer;
+    reader->rrep_addr = _rrep_address_consumer;
+    reader->rreq = _rreq_consumer;
+    reader->rreq_addr = _rreq_address_consumer;
+    memcpy(reader->rrep_entries, _address_consumer_entries,
+           sizeof(reader->rrep_entries));
+    memcpy(reader->rreq_entries, _address_consumer_entries,
+           sizeof(reader->rreq_entries));
+
+    rfc5444_reader_add_message_consumer(&reader->reader, &reader->rrep,
                                         NULL, 0);
 
-    rfc5444_reader_add_message_consumer(reader, &_rrep_address_consumer,
-                                        _address_consumer_entries,
-                                        ARRAY_SIZE(_address_consumer_entries));
+    rfc5444_reader_add_message_consumer(&reader->reader, &reader->rrep_addr,
+                                        reader->rrep_entries,
+                                        ARRAY_SIZE(reader->rrep_entries));
 
-    rfc5444_reader_add_message_consumer(reader, &_rreq_consumer,
+    rfc5444_reader_add_message_consumer(&reader->reader, &reader->rreq,
                                         NULL, 0);
 
-    rfc5444_reader_add_message_consumer(reader, &_rreq_address_consumer,
-                                        _address_consumer_entries,
-                                        ARRAY_SIZE(_address_consumer_entries));
+    rfc5444_reader_add_message_consumer(&reader->reader, &reader->rreq_addr,
+                                        reader->rreq_entries,
+                                        ARRAY_SIZE(reader->rreq_entries));
 }
 
-void aodvv2_rfc5444_handle_packet_prepare(ipv6_addr_t *sender)
+enum rfc5444_result aodvv2_reader_handle_packet(aodvv2_reader_t *reader,
+                                                const ipv6_addr_t *sender,
+                                                const struct rfc5444_reader_iovec *iov,
+                                                size_t iovcnt, uint8_t *bounce,
+                                                size_t bounce_size)
 {
-    assert(sender != NULL);
+    assert(reader != NULL && sender != NULL);
 
-    _msg_data.sender = *sender;
+    reader->sender = *sender;
+    return rfc5444_reader_handle_packet_iov(&reader->reader, iov, iovcnt,
+                                            bounce, bounce_size);
 }
@@ -30,20 +30,67 @@ extern "C" {
 #endif
 
 /**
- * @brief   Register AODVv2 message reader
+ * @brief   Number of address TLV types understood by the reader
+ */
+#define AODVV2_READER_ADDRESS_TLVS (RFC5444_MSGTLV_METRIC + 1)
+
+/**
+ * @brief   AODVv2 message reader
+ *
+ * Holds the RFC5444 reader together with its consumers and the state of the
+ * message being parsed, so separate readers don't share any parse state.
+ */
+typedef struct {
+    struct rfc5444_reader reader;                     /**< RFC5444 reader */
+    struct rfc5444_reader_tlvblock_consumer rrep;     /**< RREP consumer */
+    struct rfc5444_reader_tlvblock_consumer rrep_addr; /**< RREP address consumer */
+    struct rfc5444_reader_tlvblock_consumer rreq;     /**< RREQ consumer */
+    struct rfc5444_reader_tlvblock_consumer rreq_addr; /**< RREQ address consumer */
+    /** RREP address TLVs, indexed by @ref rfc5444_tlv_type_t */
+    struct rfc5444_reader_tlvblock_consumer_entry rrep_entries[AODVV2_READER_ADDRESS_TLVS];
+    /** RREQ address TLVs, indexed by @ref rfc5444_tlv_type_t */
+    struct rfc5444_reader_tlvblock_consumer_entry rreq_entries[AODVV2_READER_ADDRESS_TLVS];
+    /** Storage for the TLVs of the message being parsed */
+    struct rfc5444_reader_tlvblock_entry tlvs[CONFIG_AODVV2_RFC5444_READER_TLVS];
+    /** Storage for the address blocks of the message being parsed */
+    struct rfc5444_reader_addrblock_entry addrs[CONFIG_AODVV2_RFC5444_READER_ADDRBLOCKS];
+    ipv6_addr_t sender;                               /**< Sender of the packet */
+    aodvv2_message_t msg;                             /**< Message being parsed */
+} aodvv2_reader_t;
+
+/**
+ * @brief   Initialize an AODVv2 message reader
+ *
+ * @pre @p reader != NULL
  *
- * @param[in] reader Pointer to the reader context.
+ * @param[out] reader The reader.
  */
-void aodvv2_reader_init(struct rfc5444_reader *reader, kernel_pid_t netif_pid);
+void aodvv2_reader_init(aodvv2_reader_t *reader);
 
 /**
- * @brief   Sets the sender address
+ * @brief   Parse a packet and handle the RREQ and RREP messages it carries
+ *
+ * Every message is parsed from scratch, nothing from a previous message or
+ * packet is carried over. A message that's rejected is dropped on its own,
+ * the rest of the packet is still handled.
+ *
+ * @pre (@p reader != NULL) && (@p sender != NULL)
  *
- * @notes MUST be called before starting to parse the packet.
+ * @param[in] reader      The reader.
+ * @param[in] sender      The address of the sender.
+ * @param[in] iov         Segments of the packet.
+ * @param[in] iovcnt      Number of segments.
+ * @param[in] bounce      Buffer for the messages split across segments.
+ * @param[in] bounce_size Size of @p bounce.
  *
- * @param[in] sender The address of the sender.
+ * @return RFC5444_OKAY on success.
+ * @return Other @ref rfc5444_result value if the packet couldn't be parsed.
  */
-void aodvv2_rfc5444_handle_packet_prepare(ipv6_addr_t *sender);
+enum rfc5444_result aodvv2_reader_handle_packet(aodvv2_reader_t *reader,
+                                                const ipv6_addr_t *sender,
+                                                const struct rfc5444_reader_iovec *iov,
+                                                size_t iovcnt, uint8_t *bounce,
+                                                size_t bounce_size);
 
 #ifdef __cplusplus
 } /* extern "C" */
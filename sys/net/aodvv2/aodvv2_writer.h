@@ -29,6 +29,11 @@
 extern "C" {
 #endif
 
+/**
+ * @brief   Number of message types registered by aodvv2_writer_init()
+ */
+#define AODVV2_WRITER_MESSAGES (2)
+
 /**
  * @brief   Register AODVv2 message writer
  *
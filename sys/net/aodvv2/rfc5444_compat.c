@@ -61,9 +61,11 @@ void netaddr_to_ipv6_addr(struct netaddr *src, ipv6_addr_t *dst,
         *pfx_len = src->_prefix_len;
     }
 
-    /* Initialize dst with only the needed bits found in the prefix length */
+    /* Initialize dst with only the needed bits found in the prefix length,
+     * the host bits are cleared so the address can be used as a route key */
     ipv6_addr_t pfx;
     memcpy(&pfx, src->_addr, sizeof(ipv6_addr_t));
 
+    memset(dst, 0, sizeof(ipv6_addr_t));
     ipv6_addr_init_prefix(dst, &pfx, *pfx_len);
 }
@@ -111,14 +111,16 @@ static int _process_msg(vaina_msg_t *msg)
 {
     switch (msg->msg) {
 #if IS_USED(MODULE_AODVV2)
-        case VAINA_MSG_RCS_ADD:
+        case VAINA_MSG_RCS_ADD: {
             DEBUG_PUTS("vaina: adding new client");
-            if (aodvv2_rcs_add(&msg->payload.rcs_add.ip,
-                               msg->payload.rcs_add.pfx_len, 1) == NULL) {
-                DEBUG_PUTS("vaina: client set is full");
-                return -ENOSPC;
+            int res = aodvv2_rcs_add(&msg->payload.rcs_add.ip,
+                                     msg->payload.rcs_add.pfx_len, 1);
+            if (res < 0) {
+                DEBUG_PUTS("vaina: couldn't add client");
+                return res;
             }
             break;
+        }
 
         case VAINA_MSG_RCS_DEL:
             aodvv2_rcs_del(&msg->payload.rcs_del.ip, msg->payload.rcs_del.pfx_len);
@@ -64,6 +64,15 @@ _rfc5444_writer_begin_packet(struct rfc5444_writer *writer, struct rfc5444_write
   struct rfc5444_writer_postprocessor *processor;
   struct rfc5444_writer_pkthandler *handler;
 
+  /* get the buffer for this packet */
+  target->_pkt.buffer = NULL;
+  if (target->allocPacket) {
+    target->_pkt.buffer = target->allocPacket(writer, target);
+  }
+  if (target->_pkt.buffer == NULL) {
+    target->_pkt.buffer = target->packet_buffer;
+  }
+
   /* cleanup packet buffer data */
   _rfc5444_tlv_writer_init(&target->_pkt, target->packet_size, target->packet_size);
 
@@ -85,10 +85,12 @@ static enum rfc5444_result _handle_message(struct rfc5444_reader *parser, struct
 static struct rfc5444_reader_tlvblock_consumer *_add_consumer(struct rfc5444_reader_tlvblock_consumer *,
   struct avl_tree *consumer_tree, struct rfc5444_reader_tlvblock_consumer_entry *entries, int entrycount);
 static void _free_consumer(struct avl_tree *consumer_tree, struct rfc5444_reader_tlvblock_consumer *consumer);
-static struct rfc5444_reader_addrblock_entry *_malloc_addrblock_entry(void);
-static struct rfc5444_reader_tlvblock_entry *_malloc_tlvblock_entry(void);
-static void _free_addrblock_entry(struct rfc5444_reader_addrblock_entry *entry);
-static void _free_tlvblock_entry(struct rfc5444_reader_tlvblock_entry *entry);
+static void _arena_reset(struct rfc5444_reader_arena *arena);
+static void _arena_rewind(struct rfc5444_reader_arena *arena, size_t tlv_mark, size_t addr_mark);
+static struct rfc5444_reader_addrblock_entry *_malloc_addrblock_entry(struct rfc5444_reader *parser);
+static struct rfc5444_reader_tlvblock_entry *_malloc_tlvblock_entry(struct rfc5444_reader *parser);
+static void _free_addrblock_entry(struct rfc5444_reader *parser, struct rfc5444_reader_addrblock_entry *entry);
+static void _free_tlvblock_entry(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_entry *entry);
 
 static uint8_t rfc5444_get_pktversion(uint8_t v);
 
@@ -110,6 +112,8 @@ rfc5444_reader_init(struct rfc5444_reader *context) {
     context->free_addrblock_entry = _free_addrblock_entry;
   if (context->free_tlvblock_entry == NULL)
     context->free_tlvblock_entry = _free_tlvblock_entry;
+
+  _arena_reset(&context->arena);
 }
 
 /**
@@ -123,6 +127,132 @@ rfc5444_reader_cleanup(struct rfc5444_reader *context) {
   memset(&context->message_consumer, 0, sizeof(context->message_consumer));
 }
 
+/**
+ * cursor over the segments of a packet
+ */
+struct _iov_cursor {
+  /*! segments of the packet */
+  const struct rfc5444_reader_iovec *iov;
+
+  /*! number of segments */
+  size_t iovcnt;
+
+  /*! current segment */
+  size_t idx;
+
+  /*! offset within the current segment */
+  size_t off;
+};
+
+/**
+ * helper function to move a cursor past the exhausted segments
+ * @param c pointer to cursor
+ * @return number of contiguous bytes at the cursor, 0 at the end of the packet
+ */
+static size_t
+_iov_contiguous(struct _iov_cursor *c) {
+  while (c->idx < c->iovcnt && c->off >= c->iov[c->idx].length) {
+    c->idx++;
+    c->off = 0;
+  }
+  if (c->idx >= c->iovcnt) {
+    return 0;
+  }
+  return c->iov[c->idx].length - c->off;
+}
+
+/**
+ * helper function to copy bytes from a cursor without consuming them
+ * @param c pointer to cursor
+ * @param dst pointer to destination buffer
+ * @param len number of bytes to copy
+ * @return true if the packet had len bytes left, false otherwise
+ */
+static bool
+_iov_peek(const struct _iov_cursor *c, uint8_t *dst, size_t len) {
+  struct _iov_cursor tmp = *c;
+  size_t n;
+
+  while (len > 0) {
+    n = _iov_contiguous(&tmp);
+    if (n == 0) {
+      return false;
+    }
+    if (n > len) {
+      n = len;
+    }
+    memcpy(dst, &tmp.iov[tmp.idx].data[tmp.off], n);
+    tmp.off += n;
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
+
+/**
+ * helper function to count the bytes left on a cursor
+ * @param c pointer to cursor
+ * @return number of bytes until the end of the packet
+ */
+static size_t
+_iov_remaining(const struct _iov_cursor *c) {
+  size_t n, i;
+
+  n = 0;
+  for (i = c->idx; i < c->iovcnt; i++) {
+    n += c->iov[i].length;
+  }
+  return n - c->off;
+}
+
+/**
+ * helper function to consume len bytes from a cursor as a contiguous
+ * buffer. Bytes spanning several segments are copied into the bounce buffer.
+ * @param c pointer to cursor
+ * @param len number of bytes to consume, at least one
+ * @param bounce pointer to pointer to bounce buffer, advanced past the copied bytes
+ * @param bounce_size pointer to size of bounce buffer, reduced by the copied bytes
+ * @param result pointer to result variable, set on error
+ * @return pointer to len contiguous bytes, NULL if an error happened
+ */
+static const uint8_t *
+_iov_get(struct _iov_cursor *c, size_t len, uint8_t **bounce, size_t *bounce_size, enum rfc5444_result *result) {
+  const uint8_t *ptr;
+  size_t n;
+
+  /* whole block within the current segment, no copy */
+  if (_iov_contiguous(c) >= len) {
+    ptr = &c->iov[c->idx].data[c->off];
+    c->off += len;
+    return ptr;
+  }
+
+  if (_iov_remaining(c) < len) {
+    *result = RFC5444_END_OF_BUFFER;
+    return NULL;
+  }
+  if (len > *bounce_size) {
+    *result = RFC5444_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  _iov_peek(c, *bounce, len);
+  ptr = *bounce;
+  *bounce += len;
+  *bounce_size -= len;
+
+  /* consume the copied bytes */
+  while (len > 0) {
+    n = _iov_contiguous(c);
+    if (n > len) {
+      n = len;
+    }
+    c->off += n;
+    len -= n;
+  }
+  return ptr;
+}
+
 /**
  * parse a complete rfc5444 packet.
  * @param parser pointer to parser context
@@ -132,22 +262,56 @@ rfc5444_reader_cleanup(struct rfc5444_reader *context) {
  */
 enum rfc5444_result
 rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffer, size_t length)
+{
+  struct rfc5444_reader_iovec iov;
+
+  iov.data = buffer;
+  iov.length = length;
+
+  return rfc5444_reader_handle_packet_iov(parser, &iov, 1, NULL, 0);
+}
+
+/**
+ * parse a complete rfc5444 packet split in several segments, without
+ * copying it into a single buffer first.
+ * Messages and TLV blocks spanning two or more segments are copied into
+ * the bounce buffer, everything else is parsed in place.
+ * @param parser pointer to parser context
+ * @param iov array of packet segments
+ * @param iovcnt number of packet segments
+ * @param bounce pointer to bounce buffer, may be NULL
+ * @param bounce_size number of bytes in bounce buffer
+ * @return RFC5444_OKAY (0) if successful, RFC5444_... otherwise
+ */
+enum rfc5444_result
+rfc5444_reader_handle_packet_iov(struct rfc5444_reader *parser, const struct rfc5444_reader_iovec *iov, size_t iovcnt,
+  uint8_t *bounce, size_t bounce_size)
 {
   struct rfc5444_reader_tlvblock_context context;
   struct avl_tree entries;
   struct rfc5444_reader_tlvblock_consumer *consumer, *last_started;
+  struct _iov_cursor cursor;
   const uint8_t *ptr, *eob;
+  uint8_t *msg_bounce;
+  uint8_t header[4];
+  size_t length, i, msg_bounce_size;
+  uint16_t size;
   bool has_tlv;
   uint8_t first_byte;
   enum rfc5444_result result = RFC5444_OKAY;
 
+  length = 0;
+  for (i = 0; i < iovcnt; i++) {
+    length += iov[i].length;
+  }
+
   if (length > 65535) {
     return RFC5444_TOO_LARGE;
   }
 
-  /* copy pointer to prevent writing over parameter */
-  ptr = buffer;
-  eob = buffer + length;
+  memset(&cursor, 0, sizeof(cursor));
+  cursor.iov = iov;
+  cursor.iovcnt = iovcnt;
 
   /* initialize tlv context */
   memset(&context, 0, sizeof(context));
@@ -155,7 +319,11 @@ rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffe
   context.reader = parser;
 
   /* read header of packet */
-  first_byte = _rfc5444_get_u8(&ptr, eob, &result);
+  ptr = _iov_get(&cursor, 1, &bounce, &bounce_size, &result);
+  if (ptr == NULL) {
+    return result;
+  }
+  first_byte = *ptr;
   context.pkt_version = rfc5444_get_pktversion(first_byte);
   context.pkt_flags = first_byte & RFC5444_PKT_FLAGMASK;
 
@@ -170,7 +338,10 @@ rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffe
   /* check for sequence number */
   context.has_pktseqno = ((context.pkt_flags & RFC5444_PKT_FLAG_SEQNO) != 0);
   if (context.has_pktseqno) {
-    context.pkt_seqno = _rfc5444_get_u16(&ptr, eob, &result);
+    ptr = _iov_get(&cursor, 2, &bounce, &bounce_size, &result);
+    if (ptr != NULL) {
+      context.pkt_seqno = _rfc5444_get_u16(&ptr, ptr + 2, &result);
+    }
   }
 
   if (result != RFC5444_OKAY) {
@@ -188,7 +359,15 @@ rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffe
   /* check for packet tlv */
   has_tlv = (context.pkt_flags & RFC5444_PKT_FLAG_TLV) != 0;
   if (has_tlv) {
-    result = _parse_tlvblock(parser, &entries, &ptr, eob, 0);
+    /* the block stays in use until the end of the packet */
+    if (!_iov_peek(&cursor, header, 2)) {
+      return RFC5444_END_OF_BUFFER;
+    }
+    size = ((uint16_t)header[0] << 8) | header[1];
+    ptr = _iov_get(&cursor, 2 + (size_t)size, &bounce, &bounce_size, &result);
+    if (ptr != NULL) {
+      result = _parse_tlvblock(parser, &entries, &ptr, ptr + 2 + size, 0);
+    }
     if (result != RFC5444_OKAY) {
       /*
        * error while parsing TLV block, do not jump to cleanup_parse packet because
@@ -198,8 +377,8 @@ rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffe
     }
   }
 
-  /* update packet buffer pointer */
-  context.pkt_buffer = buffer;
+  /* update packet buffer pointer, only available for contiguous packets */
+  context.pkt_buffer = (iovcnt == 1) ? iov[0].data : NULL;
   context.pkt_size = length;
 
   /* handle packet consumers, call start callbacks */
@@ -234,8 +413,28 @@ rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffe
   }
 
   /* parse messages */
-  while (result == RFC5444_OKAY && ptr < eob) {
+  while (result == RFC5444_OKAY && _iov_contiguous(&cursor) > 0) {
+    /* get the whole message, its size is in the header */
+    if (!_iov_peek(&cursor, header, sizeof(header))) {
+      result = RFC5444_END_OF_BUFFER;
+      break;
+    }
+    size = ((uint16_t)header[2] << 8) | header[3];
+    if (size < sizeof(header)) {
+      result = RFC5444_END_OF_BUFFER;
+      break;
+    }
+
+    /* messages only refer to their own bytes, so the bounce buffer is reused */
+    msg_bounce = bounce;
+    msg_bounce_size = bounce_size;
+    ptr = _iov_get(&cursor, size, &msg_bounce, &msg_bounce_size, &result);
+    if (ptr == NULL) {
+      break;
+    }
+
     /* can drop packet (need to be there for error handling too) */
+    eob = ptr + size;
     result = _handle_message(parser, &context, &ptr, eob);
   }
 
@@ -253,6 +452,9 @@ cleanup_parse_packet:
   }
   _free_tlvblock(parser, &entries);
 
+  /* nothing of this packet is referenced anymore */
+  _arena_reset(&parser->arena);
+
   /* do not tell caller about packet drop */
 #if DISALLOW_CONSUMER_CONTEXT_DROP == false
   if (result == RFC5444_DROP_PACKET) {
@@ -428,7 +630,7 @@ _free_tlvblock(struct rfc5444_reader *parser, struct avl_tree *entries) {
   struct rfc5444_reader_tlvblock_entry *tlv, *ptr;
 
   avl_remove_all_elements(entries, tlv, node, ptr) {
-    parser->free_tlvblock_entry(tlv);
+    parser->free_tlvblock_entry(parser, tlv);
   }
 }
 
@@ -586,7 +788,7 @@ _parse_tlvblock(struct rfc5444_reader *parser, struct avl_tree *tlvblock, const
     }
 
     /* get memory to store TLV block entry */
-    tlv1 = parser->malloc_tlvblock_entry();
+    tlv1 = parser->malloc_tlvblock_entry(parser);
     if (tlv1 == NULL) {
       /* not enough memory left ! */
       result = RFC5444_OUT_OF_MEMORY;
@@ -1078,6 +1280,7 @@ _handle_message(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_co
   struct oonf_list_entity addr_head;
   struct rfc5444_reader_addrblock_entry *addr, *safe;
   const uint8_t *start, *end = NULL;
+  size_t tlv_mark, addr_mark;
   uint8_t flags;
   uint16_t size;
 
@@ -1085,6 +1288,8 @@ _handle_message(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_co
 
   /* initialize variables */
   result = RFC5444_OKAY;
+  tlv_mark = parser->arena._tlv_used;
+  addr_mark = parser->arena._addr_used;
   same_order[0] = same_order[1] = NULL;
   avl_init(&tlv_entries, avl_comp_uint16, true);
   oonf_list_init_head(&addr_head);
@@ -1151,7 +1356,7 @@ _handle_message(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_co
   /* parse rest of message */
   while (*ptr < end) {
     /* get memory for storing the address block entry */
-    addr = parser->malloc_addrblock_entry();
+    addr = parser->malloc_addrblock_entry(parser);
     if (addr == NULL) {
       result = RFC5444_OUT_OF_MEMORY;
       goto cleanup_parse_message;
@@ -1162,14 +1367,14 @@ _handle_message(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_co
 
     /* parse address block... */
     if ((result = _parse_addrblock(addr, tlv_context, ptr, end)) != RFC5444_OKAY) {
-      parser->free_addrblock_entry(addr);
+      parser->free_addrblock_entry(parser, addr);
       goto cleanup_parse_message;
     }
 
     /* ... and corresponding tlvblock */
     result = _parse_tlvblock(parser, &addr->tlvblock, ptr, end, addr->num_addr);
     if (result != RFC5444_OKAY) {
-      parser->free_addrblock_entry(addr);
+      parser->free_addrblock_entry(parser, addr);
       goto cleanup_parse_message;
     }
 
@@ -1262,11 +1467,14 @@ cleanup_parse_message:
   /* free address tlvblocks */
   oonf_list_for_each_element_safe(&addr_head, addr, oonf_list_node, safe) {
     _free_tlvblock(parser, &addr->tlvblock);
-    parser->free_addrblock_entry(addr);
+    parser->free_addrblock_entry(parser, addr);
   }
 
   /* free message tlvblock */
   _free_tlvblock(parser, &tlv_entries);
+
+  /* the next message reuses the arena, the packet tlvs before the mark stay */
+  _arena_rewind(&parser->arena, tlv_mark, addr_mark);
   *ptr = end;
 #if DISALLOW_CONSUMER_CONTEXT_DROP == false
   if (result > RFC5444_OKAY && result != RFC5444_DROP_PACKET) {
@@ -1341,39 +1549,104 @@ _free_consumer(struct avl_tree *consumer_tree, struct rfc5444_reader_tlvblock_co
   }
 }
 
+/**
+ * Make the whole storage of an arena available again
+ * @param arena pointer to arena
+ */
+static void
+_arena_reset(struct rfc5444_reader_arena *arena) {
+  _arena_rewind(arena, 0, 0);
+}
+
+/**
+ * Make the storage of an arena handed out after a mark available again
+ * @param arena pointer to arena
+ * @param tlv_mark number of tlvblock entries to keep
+ * @param addr_mark number of addressblock entries to keep
+ */
+static void
+_arena_rewind(struct rfc5444_reader_arena *arena, size_t tlv_mark, size_t addr_mark) {
+  if (arena->_tlv_used > tlv_mark) {
+    arena->_tlv_used = tlv_mark;
+  }
+  if (arena->_addr_used > addr_mark) {
+    arena->_addr_used = addr_mark;
+  }
+}
+
 /**
  * Internal memory allocation function for addrblock
+ * @param parser pointer to parser context
  * @return pointer to cleared addrblock
  */
 static struct rfc5444_reader_addrblock_entry *
-_malloc_addrblock_entry(void) {
+_malloc_addrblock_entry(struct rfc5444_reader *parser) {
+  struct rfc5444_reader_arena *arena = &parser->arena;
+  struct rfc5444_reader_addrblock_entry *entry;
+
+  if (arena->_addr_used < arena->addr_count) {
+    entry = &arena->addrs[arena->_addr_used++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+  }
+  if (arena->addrs != NULL && !arena->heap_fallback) {
+    return NULL;
+  }
   return calloc(1, sizeof(struct rfc5444_reader_addrblock_entry));
 }
 
 /**
  * Internal memory allocation function for rfc5444_reader_tlvblock_entry
+ * @param parser pointer to parser context
  * @return pointer to cleared rfc5444_reader_tlvblock_entry
  */
 static struct rfc5444_reader_tlvblock_entry *
-_malloc_tlvblock_entry(void) {
+_malloc_tlvblock_entry(struct rfc5444_reader *parser) {
+  struct rfc5444_reader_arena *arena = &parser->arena;
+  struct rfc5444_reader_tlvblock_entry *entry;
+
+  if (arena->_tlv_used < arena->tlv_count) {
+    entry = &arena->tlvs[arena->_tlv_used++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+  }
+  if (arena->tlvs != NULL && !arena->heap_fallback) {
+    return NULL;
+  }
   return calloc(1, sizeof(struct rfc5444_reader_tlvblock_entry));
 }
 
 /**
  * Free an addressblock entry
+ * @param parser pointer to parser context
  * @param entry addressblock entry
  */
 static void
-_free_addrblock_entry(struct rfc5444_reader_addrblock_entry *entry) {
+_free_addrblock_entry(struct rfc5444_reader *parser, struct rfc5444_reader_addrblock_entry *entry) {
+  struct rfc5444_reader_arena *arena = &parser->arena;
+
+  if ((uintptr_t)entry >= (uintptr_t)arena->addrs
+      && (uintptr_t)entry < (uintptr_t)(arena->addrs + arena->addr_count)) {
+    /* arena entries are reused once the message or packet is done */
+    return;
+  }
   free(entry);
 }
 
 /**
  * Free an tlvblock entry
+ * @param parser pointer to parser context
  * @param entry tlvblock entry
  */
 static void
-_free_tlvblock_entry(struct rfc5444_reader_tlvblock_entry *entry) {
+_free_tlvblock_entry(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_entry *entry) {
+  struct rfc5444_reader_arena *arena = &parser->arena;
+
+  if ((uintptr_t)entry >= (uintptr_t)arena->tlvs
+      && (uintptr_t)entry < (uintptr_t)(arena->tlvs + arena->tlv_count)) {
+    /* arena entries are reused once the message or packet is done */
+    return;
+  }
   free(entry);
 }
 
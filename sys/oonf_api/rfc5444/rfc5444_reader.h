@@ -115,6 +115,17 @@ struct rfc5444_reader_tlvblock_entry {
   struct bitmap256 int_drop_tlv;
 };
 
+/**
+ * a segment of a packet given to rfc5444_reader_handle_packet_iov()
+ */
+struct rfc5444_reader_iovec {
+  /*! pointer to the data of the segment */
+  const uint8_t *data;
+
+  /*! number of bytes in the segment */
+  size_t length;
+};
+
 /**
  * common context for packet, message and address TLV block
  */
@@ -368,6 +379,36 @@ struct rfc5444_reader_tlvblock_consumer {
   enum rfc5444_result (*block_callback_failed_constraints)(struct rfc5444_reader_tlvblock_context *context);
 };
 
+/**
+ * fixed storage for the tlvblock and addressblock entries of the packet
+ * being parsed, used by the default allocation callbacks.
+ * Entries are handed out in order. The ones of a message are reused by the
+ * next message, the ones of the packet tlvblock at the end of the packet.
+ * The storage must hold the packet tlvs plus the entries of the largest message.
+ */
+struct rfc5444_reader_arena {
+  /*! storage for tlvblock entries, NULL to allocate them from the heap */
+  struct rfc5444_reader_tlvblock_entry *tlvs;
+
+  /*! number of tlvblock entries in storage */
+  size_t tlv_count;
+
+  /*! storage for addressblock entries, NULL to allocate them from the heap */
+  struct rfc5444_reader_addrblock_entry *addrs;
+
+  /*! number of addressblock entries in storage */
+  size_t addr_count;
+
+  /*! true to allocate from the heap when the storage is exhausted */
+  bool heap_fallback;
+
+  /*! number of tlvblock entries in use by the packet and current message */
+  size_t _tlv_used;
+
+  /*! number of addressblock entries in use by the packet and current message */
+  size_t _addr_used;
+};
+
 /**
  * representation of the internal state of a rfc5444 parser
  */
@@ -386,29 +427,36 @@ struct rfc5444_reader {
    */
   void (*forward_message)(struct rfc5444_reader_tlvblock_context *context, const uint8_t *buffer, size_t length);
 
+  /*! storage used by the default allocation callbacks */
+  struct rfc5444_reader_arena arena;
+
   /**
    * Callback to allocate a tlvblock entry
+   * @param parser pointer to parser context
    * @return tlvblock entry, NULL if out of memory
    */
-  struct rfc5444_reader_tlvblock_entry *(*malloc_tlvblock_entry)(void);
+  struct rfc5444_reader_tlvblock_entry *(*malloc_tlvblock_entry)(struct rfc5444_reader *parser);
 
   /**
    * Callback to allocate an addressblock entry
+   * @param parser pointer to parser context
    * @return addressblock entry, NULL if out of memory
    */
-  struct rfc5444_reader_addrblock_entry *(*malloc_addrblock_entry)(void);
+  struct rfc5444_reader_addrblock_entry *(*malloc_addrblock_entry)(struct rfc5444_reader *parser);
 
   /**
    * Free a tlvblock entry
+   * @param parser pointer to parser context
    * @param entry tlvblock entry to free
    */
-  void (*free_tlvblock_entry)(struct rfc5444_reader_tlvblock_entry *entry);
+  void (*free_tlvblock_entry)(struct rfc5444_reader *parser, struct rfc5444_reader_tlvblock_entry *entry);
 
   /**
    * Free an addressblock entry
+   * @param parser pointer to parser context
    * @param entry addressblock entry to free
    */
-  void (*free_addrblock_entry)(struct rfc5444_reader_addrblock_entry *entry);
+  void (*free_addrblock_entry)(struct rfc5444_reader *parser, struct rfc5444_reader_addrblock_entry *entry);
 };
 
 EXPORT void rfc5444_reader_init(struct rfc5444_reader *);
@@ -423,6 +471,8 @@ EXPORT void rfc5444_reader_remove_packet_consumer(struct rfc5444_reader *, struc
 EXPORT void rfc5444_reader_remove_message_consumer(struct rfc5444_reader *, struct rfc5444_reader_tlvblock_consumer *);
 
 EXPORT enum rfc5444_result rfc5444_reader_handle_packet(struct rfc5444_reader *parser, const uint8_t *buffer, size_t length);
+EXPORT enum rfc5444_result rfc5444_reader_handle_packet_iov(struct rfc5444_reader *parser,
+  const struct rfc5444_reader_iovec *iov, size_t iovcnt, uint8_t *bounce, size_t bounce_size);
 
 /**
  * Call to set the do-not-forward flag in message context
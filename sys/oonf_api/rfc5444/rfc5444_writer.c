@@ -60,10 +60,13 @@ static void _register_addrtlvtype(
 static void *_copy_addrtlv_value(struct rfc5444_writer *writer, const void *value, size_t length);
 static void _lazy_free_message(struct rfc5444_writer *writer, struct rfc5444_writer_message *msg);
 static struct rfc5444_writer_message *_get_message(struct rfc5444_writer *writer, uint8_t msgid);
-static struct rfc5444_writer_address *_malloc_address_entry(void);
-static struct rfc5444_writer_addrtlv *_malloc_addrtlv_entry(void);
-static void _free_address_entry(struct rfc5444_writer_address *addr);
-static void _free_addrtlv_entry(struct rfc5444_writer_addrtlv *addrtlv);
+static void *_pool_alloc(struct rfc5444_writer_pool *pool, size_t size);
+static void _pool_free(struct rfc5444_writer_pool *pool, size_t size, void *entry);
+static void _pool_reset(struct rfc5444_writer_pool *pool);
+static struct rfc5444_writer_address *_malloc_address_entry(struct rfc5444_writer *writer);
+static struct rfc5444_writer_addrtlv *_malloc_addrtlv_entry(struct rfc5444_writer *writer);
+static void _free_address_entry(struct rfc5444_writer *writer, struct rfc5444_writer_address *addr);
+static void _free_addrtlv_entry(struct rfc5444_writer *writer, struct rfc5444_writer_addrtlv *addrtlv);
 
 /**
  * @param type TLV type
@@ -84,6 +87,10 @@ rfc5444_writer_init(struct rfc5444_writer *writer) {
   assert(writer->msg_buffer != NULL && writer->msg_size > 0);
   assert(writer->addrtlv_buffer != NULL && writer->addrtlv_size > 0);
 
+  /* the default handlers only work as pairs, see struct rfc5444_writer */
+  assert((writer->malloc_address_entry == NULL) == (writer->free_address_entry == NULL));
+  assert((writer->malloc_addrtlv_entry == NULL) == (writer->free_addrtlv_entry == NULL));
+
   /* set default memory handler functions */
   if (!writer->malloc_address_entry)
     writer->malloc_address_entry = _malloc_address_entry;
@@ -94,6 +101,10 @@ rfc5444_writer_init(struct rfc5444_writer *writer) {
   if (!writer->free_addrtlv_entry)
     writer->free_addrtlv_entry = _free_addrtlv_entry;
 
+  _pool_reset(&writer->address_pool);
+  _pool_reset(&writer->addrtlv_pool);
+  _pool_reset(&writer->message_pool);
+
   oonf_list_init_head(&writer->_targets);
 
   /* initialize packet buffer */
@@ -201,7 +212,7 @@ rfc5444_writer_add_addrtlv(struct rfc5444_writer *writer, struct rfc5444_writer_
     return RFC5444_DUPLICATE_TLV;
   }
 
-  if ((addrtlv = writer->malloc_addrtlv_entry()) == NULL) {
+  if ((addrtlv = writer->malloc_addrtlv_entry(writer)) == NULL) {
     /* out of memory error */
     return RFC5444_OUT_OF_MEMORY;
   }
@@ -213,7 +224,7 @@ rfc5444_writer_add_addrtlv(struct rfc5444_writer *writer, struct rfc5444_writer_
   /* copy value(length) */
   addrtlv->length = length;
   if (length > 0 && (addrtlv->value = _copy_addrtlv_value(writer, value, length)) == NULL) {
-    writer->free_addrtlv_entry(addrtlv);
+    writer->free_addrtlv_entry(writer, addrtlv);
     return RFC5444_OUT_OF_ADDRTLV_MEM;
   }
 
@@ -235,7 +246,7 @@ rfc5444_writer_add_addrtlv(struct rfc5444_writer *writer, struct rfc5444_writer_
  * @return pointer to address object, NULL if an error happened
  */
 struct rfc5444_writer_address *
-rfc5444_writer_add_address(struct rfc5444_writer *writer __attribute__((unused)), struct rfc5444_writer_message *msg,
+rfc5444_writer_add_address(struct rfc5444_writer *writer, struct rfc5444_writer_message *msg,
   const struct netaddr *naddr, bool mandatory) {
   struct rfc5444_writer_address *address;
 
@@ -245,7 +256,7 @@ rfc5444_writer_add_address(struct rfc5444_writer *writer __attribute__((unused))
 
   address = avl_find_element(&msg->_addr_tree, naddr, address, _addr_tree_node);
   if (address == NULL) {
-    if ((address = writer->malloc_address_entry()) == NULL) {
+    if ((address = writer->malloc_address_entry(writer)) == NULL) {
       return NULL;
     }
 
@@ -582,7 +593,7 @@ _get_message(struct rfc5444_writer *writer, uint8_t msgid) {
     return msg;
   }
 
-  if ((msg = calloc(1, sizeof(*msg))) == NULL) {
+  if ((msg = _pool_alloc(&writer->message_pool, sizeof(*msg))) == NULL) {
     return NULL;
   }
 
@@ -590,7 +601,7 @@ _get_message(struct rfc5444_writer *writer, uint8_t msgid) {
   msg->type = msgid;
   msg->_msgcreator_node.key = &msg->type;
   if (avl_insert(&writer->_msgcreators, &msg->_msgcreator_node)) {
-    free(msg);
+    _pool_free(&writer->message_pool, sizeof(*msg), msg);
     return NULL;
   }
 
@@ -671,9 +682,9 @@ _rfc5444_writer_free_addresses(struct rfc5444_writer *writer, struct rfc5444_wri
     oonf_list_remove(&addr->_addr_oonf_list_node);
 
     avl_remove_all_elements(&addr->_addrtlv_tree, addrtlv, addrtlv_node, safe_addrtlv) {
-      writer->free_addrtlv_entry(addrtlv);
+      writer->free_addrtlv_entry(writer, addrtlv);
     }
-    writer->free_address_entry(addr);
+    writer->free_address_entry(writer, addr);
   }
 
   /* allow overwriting of addrtlv-value buffer */
@@ -690,42 +701,102 @@ _lazy_free_message(struct rfc5444_writer *writer, struct rfc5444_writer_message
   if (!msg->_registered && oonf_list_is_empty(&msg->_addr_head) && oonf_list_is_empty(&msg->_msgspecific_tlvtype_head) &&
       avl_is_empty(&msg->_provider_tree)) {
     avl_remove(&writer->_msgcreators, &msg->_msgcreator_node);
-    free(msg);
+    _pool_free(&writer->message_pool, sizeof(*msg), msg);
+  }
+}
+
+/**
+ * Take a cleared object out of a pool
+ * @param pool pointer to pool
+ * @param size size of the pool objects
+ * @return pointer to cleared object, NULL if an error happened
+ */
+static void *
+_pool_alloc(struct rfc5444_writer_pool *pool, size_t size) {
+  void *entry = NULL;
+
+  if (pool->_free != NULL) {
+    entry = pool->_free;
+    memcpy(&pool->_free, entry, sizeof(pool->_free));
+  }
+  else if (pool->_used < pool->count) {
+    entry = (uint8_t *)pool->entries + pool->_used * size;
+    pool->_used++;
+  }
+  else if (pool->entries == NULL || pool->heap_fallback) {
+    return calloc(1, size);
+  }
+  else {
+    return NULL;
   }
+
+  memset(entry, 0, size);
+  return entry;
+}
+
+/**
+ * Give an object back to the pool it was taken from
+ * @param pool pointer to pool
+ * @param size size of the pool objects
+ * @param entry pointer to object
+ */
+static void
+_pool_free(struct rfc5444_writer_pool *pool, size_t size, void *entry) {
+  if ((uintptr_t)entry >= (uintptr_t)pool->entries
+      && (uintptr_t)entry < (uintptr_t)pool->entries + pool->count * size) {
+    memcpy(entry, &pool->_free, sizeof(pool->_free));
+    pool->_free = entry;
+    return;
+  }
+  free(entry);
+}
+
+/**
+ * Mark all objects of the array of a pool as unused
+ * @param pool pointer to pool
+ */
+static void
+_pool_reset(struct rfc5444_writer_pool *pool) {
+  pool->_used = 0;
+  pool->_free = NULL;
 }
 
 /**
  * Default allocater for address objects
+ * @param writer pointer to writer context
  * @return pointer to cleaned address object, NULL if an error happened
  */
 static struct rfc5444_writer_address *
-_malloc_address_entry(void) {
-  return calloc(1, sizeof(struct rfc5444_writer_address));
+_malloc_address_entry(struct rfc5444_writer *writer) {
+  return _pool_alloc(&writer->address_pool, sizeof(struct rfc5444_writer_address));
 }
 
 /**
  * Default allocator for address tlv object.
+ * @param writer pointer to writer context
  * @return pointer to cleaned address tlv object, NULL if an error happened
  */
 static struct rfc5444_writer_addrtlv *
-_malloc_addrtlv_entry(void) {
-  return calloc(1, sizeof(struct rfc5444_writer_addrtlv));
+_malloc_addrtlv_entry(struct rfc5444_writer *writer) {
+  return _pool_alloc(&writer->addrtlv_pool, sizeof(struct rfc5444_writer_addrtlv));
 }
 
 /**
  * Default deallocater for address objects
+ * @param writer pointer to writer context
  * @param addr pointer to address object
  */
 static void
-_free_address_entry(struct rfc5444_writer_address *addr) {
-  free(addr);
+_free_address_entry(struct rfc5444_writer *writer, struct rfc5444_writer_address *addr) {
+  _pool_free(&writer->address_pool, sizeof(struct rfc5444_writer_address), addr);
 }
 
 /**
  * Default deallocator for address tlv object.
+ * @param writer pointer to writer context
  * @param addrtlv pointer to address tlv object
  */
 static void
-_free_addrtlv_entry(struct rfc5444_writer_addrtlv *addrtlv) {
-  free(addrtlv);
+_free_addrtlv_entry(struct rfc5444_writer *writer, struct rfc5444_writer_addrtlv *addrtlv) {
+  _pool_free(&writer->addrtlv_pool, sizeof(struct rfc5444_writer_addrtlv), addrtlv);
 }
@@ -260,6 +260,16 @@ struct rfc5444_writer_target {
   /*! maximum number of bytes per packets allowed for target */
   size_t packet_size;
 
+  /**
+   * Callback to provide the buffer of a new packet, optional.
+   * The buffer must hold packet_size bytes and stay valid until the
+   * packet is sent, packet_buffer is used if it returns NULL.
+   * @param writer rfc5444 writer
+   * @param target rfc5444 target
+   * @return pointer to the buffer, NULL to use packet_buffer
+   */
+  void *(*allocPacket)(struct rfc5444_writer *writer, struct rfc5444_writer_target *target);
+
   /**
    * Callback to set RFC5444 packet header
    * @param writer rfc5444 writer
@@ -504,6 +514,27 @@ struct rfc5444_writer_forward_handler {
     struct rfc5444_reader_tlvblock_context *context, uint8_t *data, size_t *length);
 };
 
+/**
+ * fixed storage for writer objects of one type, used by the default
+ * allocation callbacks. Freed objects are kept in a list for reuse.
+ */
+struct rfc5444_writer_pool {
+  /*! array of objects, NULL to allocate them from the heap */
+  void *entries;
+
+  /*! number of objects in the array */
+  size_t count;
+
+  /*! true to allocate from the heap when the array is exhausted */
+  bool heap_fallback;
+
+  /*! number of objects of the array handed out at least once */
+  size_t _used;
+
+  /*! freed objects of the array, linked through their first bytes */
+  void *_free;
+};
+
 /**
  * This struct represents the internal state of a
  * rfc5444 writer.
@@ -532,29 +563,46 @@ struct rfc5444_writer {
    */
   void (*message_generation_notifier)(struct rfc5444_writer_target *target);
 
+  /*! storage for struct rfc5444_writer_address, freed after every message */
+  struct rfc5444_writer_pool address_pool;
+
+  /*! storage for struct rfc5444_writer_addrtlv, freed after every message */
+  struct rfc5444_writer_pool addrtlv_pool;
+
+  /*! storage for struct rfc5444_writer_message */
+  struct rfc5444_writer_pool message_pool;
+
   /**
-   * Callback to allocate a writer_address, NULL for use calloc()
+   * Callback to allocate a writer_address, NULL to use address_pool.
+   * The default allocate and free callbacks must be used as a pair, set
+   * both this and free_address_entry or neither.
+   * @param writer pointer to writer context
    * @return writer address, NULL if out of memory
    */
-  struct rfc5444_writer_address *(*malloc_address_entry)(void);
+  struct rfc5444_writer_address *(*malloc_address_entry)(struct rfc5444_writer *writer);
 
   /**
-   * Callback to allocate an address tlv, NULL for use calloc()
+   * Callback to allocate an address tlv, NULL to use addrtlv_pool.
+   * The default allocate and free callbacks must be used as a pair, set
+   * both this and free_addrtlv_entry or neither.
+   * @param writer pointer to writer context
    * @return address tlv, NULL if out of memory
    */
-  struct rfc5444_writer_addrtlv *(*malloc_addrtlv_entry)(void);
+  struct rfc5444_writer_addrtlv *(*malloc_addrtlv_entry)(struct rfc5444_writer *writer);
 
   /**
-   * Callback to free a writer_address, NULL for use free()
+   * Callback to free a writer_address, NULL to use address_pool
+   * @param writer pointer to writer context
    * @param addr writer address
    */
-  void (*free_address_entry)(struct rfc5444_writer_address *addr);
+  void (*free_address_entry)(struct rfc5444_writer *writer, struct rfc5444_writer_address *addr);
 
   /**
-   * Callback to free a address tlv, NULL for use free()
+   * Callback to free a address tlv, NULL to use addrtlv_pool
+   * @param writer pointer to writer context
    * @param addrtlv address tlv
    */
-  void (*free_addrtlv_entry)(struct rfc5444_writer_addrtlv *addrtlv);
+  void (*free_addrtlv_entry)(struct rfc5444_writer *writer, struct rfc5444_writer_addrtlv *addrtlv);
 
   /**
    * target of current generated message
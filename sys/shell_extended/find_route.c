@@ -51,7 +51,7 @@ int find_route_cmd(int argc, char **argv)
         goto exit;
     }
 
-    res = aodvv2_find_route(&orig_addr, &target_addr);
+    res = aodvv2_find_route(&orig_addr, &target_addr, 0);
     if (res < 0) {
         printf("%s: failed!\n", argv[0]);
         goto exit;
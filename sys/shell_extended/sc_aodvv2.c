@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 
+#include "net/aodvv2/mcmsg.h"
 #include "net/aodvv2/rcs.h"
 
 /** Default prefix length if not specified */
@@ -63,7 +64,7 @@ static int _rcs_add(int argc, char **argv)
         return 1;
     }
 
-    if (aodvv2_rcs_add(&addr, pfx_len, 1) == NULL) {
+    if (aodvv2_rcs_add(&addr, pfx_len, 1) < 0) {
         printf("error: unable to add client to RCS\n");
         return 1;
     }
@@ -77,7 +78,7 @@ static int _rcs_add(int argc, char **argv)
 int sc_aodvv2_cmd(int argc, char **argv)
 {
     if (argc < 2) {
-        printf("usage: %s [rcs]\n", argv[0]);
+        printf("usage: %s [rcs|mcmsg]\n", argv[0]);
         return 1;
     }
 
@@ -97,6 +98,9 @@ int sc_aodvv2_cmd(int argc, char **argv)
             puts("error: invalid command");
         }
     }
+    else if (strcmp(argv[1], "mcmsg") == 0) {
+        printf("evictions: %" PRIu32 "\n", aodvv2_mcmsg_evictions());
+    }
     else {
         puts("error: invalid command");
     }
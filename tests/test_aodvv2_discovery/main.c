@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the AODVv2 expanding ring search
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Checks the hop limit of the RREQ sent on every attempt of a route
+ * discovery, with the ring configured in the Makefile.
+ *
+ * The test doesn't need any hardware, it can be run on `BOARD=native`.
+ */
+
+#include <stdio.h>
+
+#include "kernel_defines.h"
+#include "net/aodvv2/conf.h"
+#include "net/aodvv2/discovery.h"
+
+/* The ring grows up to the threshold, the attempts beyond it and the last
+ * one search the whole network */
+static const uint8_t _hop_limits[CONFIG_AODVV2_DISCOVERY_ATTEMPTS_MAX] = {
+    2, 4, 6, 0, 0
+};
+
+static int _test_hop_limits(void)
+{
+    int failed = 0;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_hop_limits); i++) {
+        uint8_t hop_limit = aodvv2_discovery_hop_limit(i + 1);
+
+        if (hop_limit != _hop_limits[i]) {
+            printf("attempt %u: hop limit %u, expected %u\n", i + 1,
+                   hop_limit, _hop_limits[i]);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static void _run(const char *name, int (*test)(void))
+{
+    int failed = test();
+
+    printf("%s: %s\n", name, failed ? "[FAILED]" : "[OK]");
+}
+
+int main(void)
+{
+    puts("AODVv2 route discovery test");
+
+    _run("hop limits", _test_hop_limits);
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the AODVv2 Local Route Set
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Checks that nested prefixes sharing the same address are kept as separate
+ * routes, and that the longest prefix match still works with more distinct
+ * prefix lengths than CONFIG_AODVV2_LRS_PFX_LENS.
+ *
+ * The test doesn't need any hardware, it can be run on `BOARD=native`.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "net/aodvv2/conf.h"
+#include "net/aodvv2/lrs.h"
+
+#define PFX_LENS_NUM    (CONFIG_AODVV2_LRS_PFX_LENS + 2)
+
+static void _addr(ipv6_addr_t *addr, uint8_t group, uint8_t host)
+{
+    static const ipv6_addr_t prefix = {
+        .u8 = { 0x20, 0x01, 0x0d, 0xb8 }
+    };
+
+    *addr = prefix;
+    addr->u8[5] = group;
+    addr->u8[15] = host;
+}
+
+static void _next_hop(ipv6_addr_t *addr, uint8_t host)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0xfe;
+    addr->u8[1] = 0x80;
+    addr->u8[15] = host;
+}
+
+static void _route(aodvv2_local_route_t *route, uint8_t pfx_len,
+                   uint8_t next_hop)
+{
+    uint32_t now = aodvv2_lrs_now();
+
+    memset(route, 0, sizeof(*route));
+    _addr(&route->addr, 0, 0);
+    route->pfx_len = pfx_len;
+    route->seqnum = 1;
+    _next_hop(&route->next_hop, next_hop);
+    route->last_used = now;
+    route->expiration_time = now + (AODVV2_ROUTE_LIFETIME * MS_PER_SEC);
+    route->metric_type = METRIC_HOP_COUNT;
+    route->metric = 1;
+    route->state = ROUTE_STATE_ACTIVE;
+}
+
+/* Next hop of the longest route to 2001:db8:0:<group>::<host>, 0 if there's
+ * none */
+static uint8_t _lookup(uint8_t group, uint8_t host)
+{
+    aodvv2_local_route_t route;
+    ipv6_addr_t addr;
+
+    _addr(&addr, group, host);
+    if (!aodvv2_lrs_lookup(&addr, METRIC_HOP_COUNT, &route)) {
+        return 0;
+    }
+    return route.next_hop.u8[15];
+}
+
+static int _check(const char *name, unsigned value, unsigned expected)
+{
+    if (value != expected) {
+        printf("%s: %u, expected %u\n", name, value, expected);
+        return 1;
+    }
+    return 0;
+}
+
+/* 2001:db8::/32 and 2001:db8::/48 only differ on their prefix length */
+static int _test_nested(void)
+{
+    aodvv2_local_route_t route;
+    ipv6_addr_t addr;
+    int failed = 0;
+
+    aodvv2_lrs_init(KERNEL_PID_UNDEF, KERNEL_PID_UNDEF);
+
+    _route(&route, 32, 1);
+    failed += _check("add /32", aodvv2_lrs_add_entry(&route), true);
+    _route(&route, 48, 2);
+    failed += _check("add /48", aodvv2_lrs_add_entry(&route), true);
+
+    /* Updating one of them leaves the other alone */
+    _route(&route, 32, 3);
+    aodvv2_lrs_update_entry(&route);
+
+    _addr(&addr, 0, 0);
+    memset(&route, 0, sizeof(route));
+    failed += _check("get /32", aodvv2_lrs_get_entry(&addr, 32,
+                                                     METRIC_HOP_COUNT, &route),
+                     true);
+    failed += _check("/32 length", route.pfx_len, 32);
+    failed += _check("/32 next hop", route.next_hop.u8[15], 3);
+
+    memset(&route, 0, sizeof(route));
+    failed += _check("get /48", aodvv2_lrs_get_entry(&addr, 48,
+                                                     METRIC_HOP_COUNT, &route),
+                     true);
+    failed += _check("/48 length", route.pfx_len, 48);
+    failed += _check("/48 next hop", route.next_hop.u8[15], 2);
+
+    failed += _check("lookup in /48", _lookup(0, 1), 2);
+    failed += _check("lookup in /32", _lookup(1, 1), 3);
+
+    aodvv2_lrs_delete_entry(&addr, 48, METRIC_HOP_COUNT);
+    failed += _check("lookup after delete", _lookup(0, 1), 3);
+
+    return failed;
+}
+
+/* Nested routes with more prefix lengths than the table holds, the ones
+ * that don't fit have to be found too */
+static int _test_pfx_lens(void)
+{
+    aodvv2_local_route_t route;
+    ipv6_addr_t addr;
+    int failed = 0;
+
+    aodvv2_lrs_init(KERNEL_PID_UNDEF, KERNEL_PID_UNDEF);
+
+    /* 2001:db8::/<128 - PFX_LENS_NUM + 1> up to 2001:db8::/128, the next
+     * hop is the position of the route */
+    for (unsigned k = 0; k < PFX_LENS_NUM; k++) {
+        _route(&route, 128 - PFX_LENS_NUM + 1 + k, k + 1);
+        failed += _check("add", aodvv2_lrs_add_entry(&route), true);
+    }
+
+    /* Remove them longest first, the next longest takes over every time */
+    _addr(&addr, 0, 0);
+    for (unsigned k = PFX_LENS_NUM; k > 0; k--) {
+        failed += _check("lookup", _lookup(0, 0), k);
+        aodvv2_lrs_delete_entry(&addr, 128 - PFX_LENS_NUM + k,
+                                METRIC_HOP_COUNT);
+    }
+    failed += _check("lookup empty", _lookup(0, 0), 0);
+
+    return failed;
+}
+
+static void _run(const char *name, int (*test)(void))
+{
+    int failed = test();
+
+    printf("%s: %s\n", name, failed ? "[FAILED]" : "[OK]");
+}
+
+int main(void)
+{
+    puts("AODVv2 Local Route Set test");
+
+    _run("nested prefixes", _test_nested);
+    _run("prefix lengths", _test_pfx_lens);
+
+    return 0;
+}
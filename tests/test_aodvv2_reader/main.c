@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the AODVv2 message reader
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Feeds packets carrying several AODVv2 messages to the reader and checks
+ * that every message is handled on its own, so a rejected message doesn't
+ * take the rest of the packet with it.
+ *
+ * The test doesn't need any hardware, it can be run on `BOARD=native`.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "net/aodvv2.h"
+#include "net/aodvv2/lrs.h"
+#include "net/gnrc/netif.h"
+
+#include "aodvv2_reader.h"
+
+#define MSG_HOP_LIMIT   (10)
+#define RREQ_LEN        (54)
+#define RREP_LEN        (59)
+
+static const ipv6_addr_t _sender = {
+    .u8 = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01 }
+};
+
+static aodvv2_reader_t _reader;
+static uint8_t _pkt[512];
+static size_t _pkt_len;
+
+static void _addr(ipv6_addr_t *addr, uint8_t host)
+{
+    static const ipv6_addr_t prefix = {
+        .u8 = { 0x20, 0x01, 0x0d, 0xb8 }
+    };
+
+    *addr = prefix;
+    addr->u8[15] = host;
+}
+
+static void _pkt_begin(void)
+{
+    /* Version 0, no sequence number and no packet TLVs */
+    _pkt[0] = 0x00;
+    _pkt_len = 1;
+}
+
+/* Message header with hop limit and 16 byte addresses, no message TLVs,
+ * followed by an address block with the OrigNode 2001:db8::<orig> and the
+ * TargNode 2001:db8::<targ> */
+static uint8_t *_put_msg(uint8_t *p, uint8_t type, uint8_t len, uint8_t orig,
+                         uint8_t targ)
+{
+    ipv6_addr_t addr;
+
+    *p++ = type;
+    *p++ = RFC5444_MSG_FLAG_HOPLIMIT | (sizeof(ipv6_addr_t) - 1);
+    *p++ = 0x00;
+    *p++ = len;
+    *p++ = MSG_HOP_LIMIT;
+    *p++ = 0x00;
+    *p++ = 0x00;
+
+    *p++ = 2;
+    *p++ = 0x00;
+    _addr(&addr, orig);
+    memcpy(p, &addr, sizeof(addr));
+    p += sizeof(addr);
+    _addr(&addr, targ);
+    memcpy(p, &addr, sizeof(addr));
+    p += sizeof(addr);
+
+    return p;
+}
+
+static uint8_t *_put_seqnum(uint8_t *p, uint8_t type, uint8_t idx,
+                            uint8_t seqnum)
+{
+    *p++ = type;
+    *p++ = RFC5444_TLV_FLAG_SINGLE_IDX | RFC5444_TLV_FLAG_VALUE;
+    *p++ = idx;
+    *p++ = 1;
+    *p++ = seqnum;
+
+    return p;
+}
+
+static uint8_t *_put_metric(uint8_t *p, uint8_t idx, uint8_t metric)
+{
+    *p++ = RFC5444_MSGTLV_METRIC;
+    *p++ = RFC5444_TLV_FLAG_TYPEEXT | RFC5444_TLV_FLAG_SINGLE_IDX |
+           RFC5444_TLV_FLAG_VALUE;
+    *p++ = METRIC_HOP_COUNT;
+    *p++ = idx;
+    *p++ = 1;
+    *p++ = metric;
+
+    return p;
+}
+
+/* RREQ with the OrigSeqNum and Metric TLVs of the OrigNode */
+static void _pkt_add_rreq(uint8_t orig, uint8_t seqnum, uint8_t metric,
+                          uint8_t targ)
+{
+    uint8_t *p = &_pkt[_pkt_len];
+
+    p = _put_msg(p, RFC5444_MSGTYPE_RREQ, RREQ_LEN, orig, targ);
+    *p++ = 0x00;
+    *p++ = 11;
+    p = _put_seqnum(p, RFC5444_MSGTLV_ORIGSEQNUM, 0, seqnum);
+    p = _put_metric(p, 0, metric);
+
+    _pkt_len += RREQ_LEN;
+}
+
+/* RREP with the OrigSeqNum TLV of the OrigNode and the TargSeqNum and Metric
+ * TLVs of the TargNode */
+static void _pkt_add_rrep(uint8_t orig, uint8_t targ, uint8_t seqnum,
+                          uint8_t metric)
+{
+    uint8_t *p = &_pkt[_pkt_len];
+
+    p = _put_msg(p, RFC5444_MSGTYPE_RREP, RREP_LEN, orig, targ);
+    *p++ = 0x00;
+    *p++ = 16;
+    p = _put_seqnum(p, RFC5444_MSGTLV_ORIGSEQNUM, 0, 1);
+    p = _put_seqnum(p, RFC5444_MSGTLV_TARGSEQNUM, 1, seqnum);
+    p = _put_metric(p, 1, metric);
+
+    _pkt_len += RREP_LEN;
+}
+
+static int _pkt_handle(void)
+{
+    struct rfc5444_reader_iovec iov = {
+        .data = _pkt,
+        .length = _pkt_len,
+    };
+
+    return aodvv2_reader_handle_packet(&_reader, &_sender, &iov, 1, NULL, 0);
+}
+
+static int _check_route(uint8_t host)
+{
+    ipv6_addr_t addr;
+
+    _addr(&addr, host);
+    if (!aodvv2_lrs_get_entry(&addr, 128, METRIC_HOP_COUNT, NULL)) {
+        printf("no route to 2001:db8::%x\n", host);
+        return 1;
+    }
+    return 0;
+}
+
+/* A redundant RREQ is dropped, the valid one after it in the same packet is
+ * still handled */
+static int _test_redundant(void)
+{
+    int failed = 0;
+    int res;
+
+    _pkt_begin();
+    _pkt_add_rreq(0x10, 1, 1, 0xff);
+    _pkt_add_rreq(0x10, 1, 1, 0xff);
+    _pkt_add_rreq(0x11, 1, 1, 0xff);
+
+    res = _pkt_handle();
+    if (res != RFC5444_OKAY) {
+        printf("redundant: res=%d\n", res);
+        failed++;
+    }
+    failed += _check_route(0x10);
+    failed += _check_route(0x11);
+    return failed;
+}
+
+/* Aggregated packet with RREQs and RREPs, some of them rejected. The RREP is
+ * forwarded on the route the RREQ before it in the same packet created. */
+static int _test_mixed(void)
+{
+    int failed = 0;
+    int res;
+
+    _pkt_begin();
+    _pkt_add_rreq(0x20, 1, 1, 0xff);
+    _pkt_add_rreq(0x20, 1, 1, 0xff);
+    _pkt_add_rrep(0x20, 0x30, 1, 1);
+    _pkt_add_rrep(0x20, 0x30, 1, 1);
+    _pkt_add_rreq(0x21, 1, 1, 0xff);
+
+    res = _pkt_handle();
+    if (res != RFC5444_OKAY) {
+        printf("mixed: res=%d\n", res);
+        failed++;
+    }
+    failed += _check_route(0x20);
+    failed += _check_route(0x30);
+    failed += _check_route(0x21);
+    return failed;
+}
+
+static void _run(const char *name, int (*test)(void))
+{
+    int failed = test();
+
+    printf("%s: %s\n", name, failed ? "[FAILED]" : "[OK]");
+}
+
+int main(void)
+{
+    puts("AODVv2 reader test");
+
+    gnrc_netif_t *netif = gnrc_netif_iter(NULL);
+    if (netif == NULL || aodvv2_init(netif) < 0) {
+        puts("Error: couldn't initialize AODVv2");
+        return 1;
+    }
+
+    aodvv2_reader_init(&_reader);
+
+    _run("redundant message", _test_redundant);
+    _run("mixed messages", _test_mixed);
+
+    return 0;
+}
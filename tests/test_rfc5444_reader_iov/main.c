@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for parsing RFC 5444 packets split across
+ *              segments
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Feeds the same aggregated packet to rfc5444_reader_handle_packet_iov() cut
+ * into segments at every possible position, so every field of the packet
+ * header, the TLV blocks, the address block and the message size field is
+ * split at least once. It also checks zero-length segments and truncated
+ * packets, and that the messages of a packet with packet TLVs fit in a reader
+ * storage sized for a single message.
+ *
+ * The test doesn't need any hardware, it can be run on `BOARD=native`.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "kernel_defines.h"
+#include "rfc5444/rfc5444_reader.h"
+
+#define MSG_TYPE        (10)
+#define MSG_COUNT       (3)
+
+/* Packet header: version 0, has seqnum and TLVs, one TLV with value AB CD */
+static const uint8_t _pkt_header[] = {
+    0x0C, 0x12, 0x34,
+    0x00, 0x05, 0x01, 0x10, 0x02, 0xAB, 0xCD,
+};
+
+/* Message: 4 byte addresses, 23 bytes long, one message TLV with value
+ * AB CD and one address 10.0.0.1 with an address TLV of value 7F */
+static const uint8_t _msg[] = {
+    MSG_TYPE, 0x03, 0x00, 0x17,
+    0x00, 0x05, 0x01, 0x10, 0x02, 0xAB, 0xCD,
+    0x01, 0x00, 0x0A, 0x00, 0x00, 0x01,
+    0x00, 0x04, 0x02, 0x10, 0x01, 0x7F,
+};
+
+#define PKT_LEN         (sizeof(_pkt_header) + MSG_COUNT * sizeof(_msg))
+
+static uint8_t _pkt[PKT_LEN];
+/* The packet header stays in the bounce buffer for the whole packet, the
+ * messages reuse the rest of it */
+static uint8_t _bounce[sizeof(_pkt_header) + sizeof(_msg)];
+
+/* Enough segments to put every byte in its own one, with empty segments
+ * before, between and after them */
+static struct rfc5444_reader_iovec _iov[2 * PKT_LEN + 1];
+
+static struct rfc5444_reader _reader;
+
+static unsigned _msgs;
+static unsigned _msg_tlvs;
+static unsigned _addr_tlvs;
+
+static enum rfc5444_result _cb_message_start(
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    (void)cont;
+    _msgs++;
+    return RFC5444_OKAY;
+}
+
+static enum rfc5444_result _cb_message_tlv(
+        struct rfc5444_reader_tlvblock_entry *entry,
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    (void)cont;
+    if (entry->type == 1 && entry->length == 2 &&
+        entry->single_value[0] == 0xAB && entry->single_value[1] == 0xCD) {
+        _msg_tlvs++;
+    }
+    return RFC5444_OKAY;
+}
+
+static enum rfc5444_result _cb_address_tlv(
+        struct rfc5444_reader_tlvblock_entry *entry,
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    static const uint8_t addr[] = { 0x0A, 0x00, 0x00, 0x01 };
+
+    if (entry->type == 2 && entry->length == 1 &&
+        entry->single_value[0] == 0x7F &&
+        memcmp(cont->addr._addr, addr, sizeof(addr)) == 0) {
+        _addr_tlvs++;
+    }
+    return RFC5444_OKAY;
+}
+
+static struct rfc5444_reader_tlvblock_consumer _msg_consumer = {
+    .msg_id = MSG_TYPE,
+    .start_callback = _cb_message_start,
+    .tlv_callback = _cb_message_tlv,
+};
+
+static struct rfc5444_reader_tlvblock_consumer _addr_consumer = {
+    .msg_id = MSG_TYPE,
+    .addrblock_consumer = true,
+    .tlv_callback = _cb_address_tlv,
+};
+
+static int _parse(size_t iovcnt, uint8_t *bounce, size_t bounce_size)
+{
+    _msgs = 0;
+    _msg_tlvs = 0;
+    _addr_tlvs = 0;
+    return rfc5444_reader_handle_packet_iov(&_reader, _iov, iovcnt,
+                                            bounce, bounce_size);
+}
+
+static int _check(const char *name, int res, int expected_res,
+                  unsigned expected_msgs)
+{
+    if (res != expected_res || _msgs != expected_msgs ||
+        _msg_tlvs != expected_msgs || _addr_tlvs != expected_msgs) {
+        printf("%s: res=%d msgs=%u msg_tlvs=%u addr_tlvs=%u, expected "
+               "res=%d msgs=%u\n", name, res, _msgs, _msg_tlvs, _addr_tlvs,
+               expected_res, expected_msgs);
+        return 1;
+    }
+    return 0;
+}
+
+static int _test_single_segment(void)
+{
+    _iov[0].data = _pkt;
+    _iov[0].length = PKT_LEN;
+
+    return _check("single", _parse(1, NULL, 0), RFC5444_OKAY, MSG_COUNT);
+}
+
+/* Every split into three segments, including the empty ones at a == b or at
+ * either end of the packet */
+static int _test_three_segments(void)
+{
+    int failed = 0;
+
+    for (size_t a = 0; a <= PKT_LEN; a++) {
+        for (size_t b = a; b <= PKT_LEN; b++) {
+            _iov[0].data = _pkt;
+            _iov[0].length = a;
+            _iov[1].data = _pkt + a;
+            _iov[1].length = b - a;
+            _iov[2].data = _pkt + b;
+            _iov[2].length = PKT_LEN - b;
+
+            failed += _check("three", _parse(3, _bounce, sizeof(_bounce)),
+                             RFC5444_OKAY, MSG_COUNT);
+        }
+    }
+    return failed;
+}
+
+/* One byte per segment with an empty segment around every byte */
+static int _test_byte_segments(void)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < PKT_LEN; i++) {
+        _iov[n].data = NULL;
+        _iov[n++].length = 0;
+        _iov[n].data = &_pkt[i];
+        _iov[n++].length = 1;
+    }
+    _iov[n].data = NULL;
+    _iov[n++].length = 0;
+
+    return _check("bytes", _parse(n, _bounce, sizeof(_bounce)),
+                  RFC5444_OKAY, MSG_COUNT);
+}
+
+/* Packet cut short at every length, split in the middle. Only the messages
+ * that arrived completely may be delivered. */
+static int _test_truncated(void)
+{
+    int failed = 0;
+
+    for (size_t len = 0; len < PKT_LEN; len++) {
+        unsigned complete = 0;
+        int expected = RFC5444_END_OF_BUFFER;
+
+        if (len >= sizeof(_pkt_header)) {
+            complete = (len - sizeof(_pkt_header)) / sizeof(_msg);
+            if ((len - sizeof(_pkt_header)) % sizeof(_msg) == 0) {
+                expected = RFC5444_OKAY;
+            }
+        }
+
+        _iov[0].data = _pkt;
+        _iov[0].length = len / 2;
+        _iov[1].data = _pkt + len / 2;
+        _iov[1].length = len - len / 2;
+
+        failed += _check("truncated", _parse(2, _bounce, sizeof(_bounce)),
+                         expected, complete);
+    }
+    return failed;
+}
+
+/* A message spanning segments can't be parsed without a bounce buffer, one
+ * too small to hold it isn't enough either */
+static int _test_no_bounce(void)
+{
+    int failed = 0;
+
+    _iov[0].data = _pkt;
+    _iov[0].length = sizeof(_pkt_header) + 1;
+    _iov[1].data = _pkt + sizeof(_pkt_header) + 1;
+    _iov[1].length = PKT_LEN - sizeof(_pkt_header) - 1;
+
+    failed += _check("no bounce", _parse(2, NULL, 0),
+                     RFC5444_OUT_OF_MEMORY, 0);
+    failed += _check("small bounce", _parse(2, _bounce, sizeof(_msg) - 1),
+                     RFC5444_OUT_OF_MEMORY, 0);
+    return failed;
+}
+
+/* Storage for the packet TLV and the entries of a single message, the
+ * messages of the packet have to share it */
+static int _test_arena(void)
+{
+    static struct rfc5444_reader_tlvblock_entry tlvs[3];
+    static struct rfc5444_reader_addrblock_entry addrs[1];
+    int failed;
+
+    _reader.arena.tlvs = tlvs;
+    _reader.arena.tlv_count = ARRAY_SIZE(tlvs);
+    _reader.arena.addrs = addrs;
+    _reader.arena.addr_count = ARRAY_SIZE(addrs);
+
+    failed = _test_single_segment() + _test_three_segments() +
+             _test_truncated();
+
+    memset(&_reader.arena, 0, sizeof(_reader.arena));
+    return failed;
+}
+
+static void _run(const char *name, int (*test)(void))
+{
+    int failed = test();
+
+    printf("%s: %s\n", name, failed ? "[FAILED]" : "[OK]");
+}
+
+int main(void)
+{
+    puts("RFC 5444 reader segment test");
+
+    memcpy(_pkt, _pkt_header, sizeof(_pkt_header));
+    for (unsigned i = 0; i < MSG_COUNT; i++) {
+        memcpy(&_pkt[sizeof(_pkt_header) + i * sizeof(_msg)], _msg,
+               sizeof(_msg));
+    }
+
+    rfc5444_reader_init(&_reader);
+    rfc5444_reader_add_message_consumer(&_reader, &_msg_consumer, NULL, 0);
+    rfc5444_reader_add_message_consumer(&_reader, &_addr_consumer, NULL, 0);
+
+    _run("single segment", _test_single_segment);
+    _run("three segments", _test_three_segments);
+    _run("byte segments", _test_byte_segments);
+    _run("truncated", _test_truncated);
+    _run("no bounce buffer", _test_no_bounce);
+    _run("arena", _test_arena);
+
+    return 0;
+}